@@ -7,20 +7,17 @@
 
 #include <algorithm>
 #include <vector>
+#include <climits>
 
 using namespace std;
 
 namespace AST {
     // Abstract syntax tree.  ASTNode is abstract base class for all other nodes.
 
-    string Program::infer_type(Semantics *s, Whereami whereami){ 
-        // infer classes
-        classes_.infer_type(s, whereami);
-        // for (string c: s->all_types){
-        //     s->propagate_instance_var_types(c);
-        // }
+    // Type inference works on one unit at a time (Semantics::check_types):
+    // the main statements, a class's constructor, or a method.
 
-        // then do same for main body
+    string Program::infer_type(Semantics *s, Whereami whereami){ 
         whereami.classname = "Main";
         whereami.methodname = "Main";
         statements_.infer_type(s, whereami);
@@ -35,11 +32,6 @@ namespace AST {
         
         // all "this" vars should now be instantiated. Pass down types!
         s->propagate_instance_var_types(name_.text_);
-
-        for (AST::Method *m: methods_.elements_){
-            whereami.methodname = m->name_.text_;
-            m->infer_type(s, whereami);
-        }
         return name_.text_;
     }
 
@@ -110,6 +102,25 @@ namespace AST {
         return "While";
     }
 
+    string Typecase::infer_type(Semantics *s, Whereami whereami){
+        expr_.infer_type(s, whereami);
+        cases_.infer_type(s, whereami);
+        return "Typecase";
+    }
+
+    string Type_Alternative::infer_type(Semantics *s, Whereami whereami){
+        string cname = classname_.get_name();
+        if (s->type_id(cname)<0){
+            cerr<<"Type error: Unknown class "<<cname<<" in typecase."<<endl;
+            exit(1);
+        }
+        string vname = ident_.get_name();
+        string new_type = s->type_union(s->get_curr_type(vname, whereami), cname);
+        s->unique_update(vname, new_type, whereami);
+        block_.infer_type(s, whereami);
+        return cname;
+    }
+
     string Load::infer_type(Semantics *s, Whereami whereami){
         string vname = loc_.get_name();
         // if (vname.find("this")!=string::npos){
@@ -162,6 +173,7 @@ namespace AST {
                     exit(1);
                 }
                 for (int i=0; i<n_expected; i++){
+                    s->type_read(mn, mn->formals[i]);
                     string expected = mn->types[mn->formals[i]];
                     string provided = (actuals_.elements_[i])->infer_type(s, whereami);
                     if (expected!=provided){
@@ -198,6 +210,7 @@ namespace AST {
             exit(1);
         }
         for (int i=0; i<n_expected; i++){
+            s->type_read(constr, constr->formals[i]);
             string expected = constr->types[constr->formals[i]];
             string provided = (actuals_.elements_[i])->infer_type(s, whereami);
             if (expected!=provided){
@@ -218,7 +231,10 @@ namespace AST {
         string type = type_.get_name();
         // FORMAL VARIABLE TYPES CANNOT BE CHANGED
             // BUT assigning to as subtype is fine
-        local->types[var_name] = type;
+        if (local->types[var_name]!=type){
+            local->types[var_name] = type;
+            s->type_changed(local, var_name);
+        }
         return "Formal";
     }
 
@@ -263,6 +279,141 @@ namespace AST {
         return "String";
     }
 
+    //===================================================//
+    //===================================================//
+            //=========  CONSTANT FOLDING ========//
+    //===================================================//
+    //===================================================//
+
+    /* Runs after type checking.  Int, String and Boolean values are
+     * built in and cannot be subclassed, so their methods can be
+     * evaluated here.  A variable assigned exactly once in a method,
+     * to a constant, has that value wherever it is used.
+     */
+    int Program::eval(EvalContext &ctxt){
+        classes_.eval(ctxt);
+        ctxt.symtab.clear();
+        ctxt.assigns.clear();
+        statements_.count_assigns(ctxt.assigns);
+        statements_.eval(ctxt);
+        return 0;
+    }
+
+    int Method::eval(EvalContext &ctxt){
+        ctxt.symtab.clear();
+        ctxt.assigns.clear();
+        for (Formal *f: formals_.elements_){
+            ctxt.assigns[f->var_.get_name()]++; // Bound by the call
+        }
+        statements_.count_assigns(ctxt.assigns);
+        statements_.eval(ctxt);
+        return 0;
+    }
+
+    int Assign::eval(EvalContext &ctxt){
+        string vname = lexpr_.get_name();
+        if (rexpr_.eval(ctxt) && vname.find(".")==string::npos && ctxt.assigns[vname]==1){
+            ctxt.symtab[vname] = ctxt.value;
+        }
+        return 0;
+    }
+
+    int Load::eval(EvalContext &ctxt){
+        string vname = loc_.get_name();
+        if (vname=="true"||vname=="false"){
+            ctxt.value = ConstValue();
+            ctxt.value.type = "Boolean";
+            ctxt.value.num = (vname=="true");
+            return fold(ctxt);
+        }
+        if (ctxt.symtab.count(vname)==0){ return 0; }
+        ctxt.value = ctxt.symtab[vname];
+        return fold(ctxt);
+    }
+
+    // Int arithmetic wraps around, as it does in the generated C
+    static int wrap(long long v){ return (int) (unsigned int) v; }
+
+    int Call::eval(EvalContext &ctxt){
+        int known = receiver_.eval(ctxt);
+        ConstValue l = ctxt.value;
+        vector<ConstValue> args;
+        for (Expr *a: actuals_.elements_){
+            if (a->eval(ctxt)){ args.push_back(ctxt.value); }
+            else { known = 0; }
+        }
+        if (!known){ return 0; }
+        string mname = method_.get_name();
+        ConstValue v;
+        if (args.size()==0){
+            if (mname!="STR"){ return 0; }
+            v.type = "String";
+            if (l.type=="Int"){ v.text = to_string(l.num); }
+            else if (l.type=="Boolean"){ v.text = l.num ? "true" : "false"; }
+            else { v.text = l.text; }
+        } else if (args.size()==1 && args[0].type==l.type){
+            ConstValue r = args[0];
+            v.type = "Boolean";
+            if (l.type=="Int"){
+                if (mname=="PLUS"){ v.type = "Int"; v.num = wrap((long long) l.num + r.num); }
+                else if (mname=="MINUS"){ v.type = "Int"; v.num = wrap((long long) l.num - r.num); }
+                else if (mname=="TIMES"){ v.type = "Int"; v.num = wrap((long long) l.num * r.num); }
+                else if (mname=="DIVIDE"){
+                    // Division by zero (or overflow) is left to happen at run time
+                    if (r.num==0 || (r.num==-1 && l.num==INT_MIN)){ return 0; }
+                    v.type = "Int"; v.num = l.num / r.num;
+                }
+                else if (mname=="LESS"){ v.num = l.num < r.num; }
+                else if (mname=="GREATER"){ v.num = l.num > r.num; }
+                else if (mname=="ATMOST"){ v.num = l.num <= r.num; }
+                else if (mname=="ATLEAST"){ v.num = l.num >= r.num; }
+                else if (mname=="EQUALS"){ v.num = l.num == r.num; }
+                else { return 0; }
+            } else if (l.type=="String"){
+                if (mname=="PLUS"){ v.type = "String"; v.text = l.text + r.text; }
+                else if (mname=="EQUALS"){ v.num = l.text == r.text; }
+                else if (mname=="LESS"){ v.num = l.text < r.text; }
+                else { return 0; }
+            } else if (l.type=="Boolean" && mname=="EQUALS"){
+                v.num = l.num == r.num;
+            } else { return 0; }
+        } else { return 0; }
+        ctxt.value = v;
+        return fold(ctxt);
+    }
+
+    int And::eval(EvalContext &ctxt){
+        int known = left_.eval(ctxt);
+        int lv = ctxt.value.num;
+        if (!right_.eval(ctxt) || !known){ return 0; }
+        ctxt.value.num = lv && ctxt.value.num;
+        return fold(ctxt);
+    }
+
+    int Or::eval(EvalContext &ctxt){
+        int known = left_.eval(ctxt);
+        int lv = ctxt.value.num;
+        if (!right_.eval(ctxt) || !known){ return 0; }
+        ctxt.value.num = lv || ctxt.value.num;
+        return fold(ctxt);
+    }
+
+    int Not::eval(EvalContext &ctxt){
+        if (!left_.eval(ctxt)){ return 0; }
+        ctxt.value.num = !ctxt.value.num;
+        return fold(ctxt);
+    }
+
+    string Expr::folded_rval(CodegenContext &ctxt){
+        if (folded_->type=="Int"){ return ctxt.int_const(folded_->num); }
+        if (folded_->type=="String"){ return ctxt.str_const(folded_->text); }
+        return folded_->num ? "lit_true" : "lit_false";
+    }
+
+    void Expr::folded_branch(CodegenContext &ctxt, string true_branch, string false_branch){
+        ctxt.emit_jump(folded_->num ? true_branch : false_branch, "Constant condition");
+    }
+
     //===================================================//
     //===================================================//
             //=========  CODE GENERATiON ========//
@@ -272,19 +423,34 @@ namespace AST {
 
     string Program::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
         ctxt.emit("#include <stdio.h>");
+        ctxt.emit("#define QUACK_LAST_CLASS_ID "+to_string(s->all_types.size()-1));
         ctxt.emit("#include \"Builtins.c\"");
 
-        classes_.emit_obj(ctxt, s, whereami); // ensure namespace exists
-        classes_.gen_rval(ctxt, s, whereami);
-
-        ctxt.emit("int main(int argc, char **argv) {");
+        // Classes and main body are buffered so that the literal pool
+        // they fill in can be emitted ahead of them.
+        stringstream code;
+        CodegenContext codectxt = ctxt.fresh(code);
+        classes_.emit_obj(codectxt, s, whereami); // ensure namespace exists
+        // Methods may be called directly before they are defined
+        for (Class *c: classes_.elements_){ c->emit_prototypes(codectxt, s, whereami); }
+        codectxt.emit("");
+        classes_.gen_rval(codectxt, s, whereami);
+
+        codectxt.emit("int main(int argc, char **argv) {");
+        codectxt.emit("quack_init();");
         whereami.classname = "Main";
         whereami.methodname = "Main";
         //CodegenContext *bodyctxt = new CodegenContext(ctxt);
-        CodegenContext bodyctxt(cout);
+        CodegenContext bodyctxt = codectxt.fresh();
+        IRFunction fn("main");
+        bodyctxt.begin_function(fn);
         //target_reg = ctxt.alloc_reg("Obj");
         statements_.gen_rval(bodyctxt, s, whereami);
-        ctxt.emit("}");
+        bodyctxt.end_function();
+        codectxt.emit("}");
+
+        ctxt.emit_const_pool();
+        ctxt.emit(code.str());
         return "";
     }
 
@@ -293,29 +459,83 @@ namespace AST {
         ctxt.emit("");
     }
 
+    /* Does a method make tail calls that may reach another user method?
+     * Those may go through the trampoline, so the method is compiled as
+     * a body and an entry point that runs it (Builtins.h).
+     */
+    static bool makes_tail_calls(Semantics *s, Whereami method){
+        Method *m = s->hierarchy[method.classname].methods[method.methodname].ast;
+        if (m==nullptr){ return false; }
+        vector<Whereami> callees;
+        m->statements_.tail_callees(s, method, callees);
+        for (Whereami c: callees){
+            if (s->hierarchy[c.classname].methods[c.methodname].ast!=nullptr
+                    && (c.classname!=method.classname || c.methodname!=method.methodname)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Class::emit_prototypes(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        string cname = name_.text_;
+        whereami.classname = cname;
+        for (string m: s->hierarchy[cname].methods_list){
+            MethodNode local = s->hierarchy[cname].methods[m];
+            if (local.inherited_from!=cname){ continue; }
+            whereami.methodname = m;
+            string fname = cname==m ? "new_"+cname : cname+"_method_"+m;
+            string sig = s->emit_full_sig(ctxt, whereami);
+            ctxt.emit("obj_"+local.returns+" "+fname+"("+sig+");");
+            if (cname!=m && makes_tail_calls(s, whereami)){
+                ctxt.ir_opts->trampolined.insert(fname);
+                ctxt.emit("obj_"+local.returns+" "+fname+"_body("+sig+");");
+            }
+        }
+    }
+
     string Class::gen_rval(CodegenContext &octxt, Semantics *s, Whereami whereami){
-        CodegenContext ctxt(cout);
+        CodegenContext ctxt = octxt.fresh();
         string cname = name_.text_;
         whereami.classname = cname;
         ctxt.emit("typedef struct obj_"+cname+"_struct {");
+        ctxt.emit("struct gc_header gc;");
         ctxt.emit("class_"+cname+" clazz;");
         string type, fullname, loc;
         vector<string> insts = s->hierarchy[cname].instance_vars;
+        vector<string> fields;
         for (string v:s->hierarchy[cname].instance_vars){
+            if (v=="this"){ continue; } // Listed with the fields, but not one
             type = s->hierarchy[cname].methods[cname].types[v];
             string ivar = ctxt.get_var(v, type);
+            if (!ctxt.is_unboxed(v)){ fields.push_back(ivar); }
         }
         ctxt.emit("} *obj_"+cname+";");
         ctxt.emit("");
+        // Layout for the collector: every field is an object reference
+        string offsets = "NULL";
+        if (fields.size()>0){
+            ctxt.emit("const size_t gc_fields_"+cname+"[] = {");
+            for (string f: fields){
+                ctxt.emit("offsetof(struct obj_"+cname+"_struct, "+f+"),");
+            }
+            ctxt.emit("};");
+            offsets = "gc_fields_"+cname;
+        }
+        ctxt.emit("const struct gc_type gc_type_"+cname+" = { sizeof(struct obj_"+cname+"_struct), "
+                  +to_string(fields.size())+", "+offsets+", NULL };");
+        ctxt.emit("");
         ctxt.emit("struct class_"+cname+"_struct {");
+        ctxt.emit("int id;");
+        ctxt.emit("int last_descendant_id;");
         for (string m: s->hierarchy[cname].methods_list){
             whereami.methodname = m;
             s->emit_method_sig(ctxt, whereami);
         }
         ctxt.emit("};");
         ctxt.emit("");
-        ctxt.emit("struct class_"+cname+"_struct the_class_"+cname+"_struct;");
-        ctxt.emit("class_"+cname+" the_class_"+cname+";");
+        ctxt.emit("extern const struct class_"+cname+"_struct the_class_"+cname+"_struct;");
+        ctxt.emit("extern const class_"+cname+" the_class_"+cname+";");
         ctxt.emit("");
 
         whereami.methodname = cname;
@@ -323,16 +543,24 @@ namespace AST {
         constructor_.gen_rval(ctxt, s, whereami);
         methods_.gen_rval(ctxt, s, whereami);
 
-        ctxt.emit("struct class_"+cname+"_struct the_class_"+cname+"_struct = {");
+        ctxt.emit("const struct class_"+cname+"_struct the_class_"+cname+"_struct = {");
         ctxt.emit("//print out methods - based on where inherited from!!!");
         s->emit_class_struct(ctxt, cname);
         ctxt.emit("};");
 
-        ctxt.emit("class_"+cname+" the_class_"+cname+" = &the_class_"+cname+"_struct;");
+        ctxt.emit("const class_"+cname+" the_class_"+cname+" = &the_class_"+cname+"_struct;");
         ctxt.emit("");
         return "";
     }
 
+    /* C types of a method's result, receiver, and formals */
+    static vector<string> c_signature(Semantics *s, string cname, string mname){
+        MethodNode local = s->hierarchy[cname].methods[mname];
+        vector<string> sig = {"obj_"+local.returns, "obj_"+cname};
+        for (string f: local.formals){ sig.push_back("obj_"+local.types[f]); }
+        return sig;
+    }
+
     string Method::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
         //CodegenContext mctxt(cout);
         CodegenContext mctxt = ctxt;
@@ -345,30 +573,163 @@ namespace AST {
         }
         string returns = local.returns;
 
+        string fname = cname==mname ? "new_"+cname : cname+"_method_"+mname;
+        string sig = s->emit_full_sig(mctxt, whereami);
+        bool trampolined = ctxt.ir_opts->trampolined.count(fname)!=0;
+        IRFunction fn(fname);
+        TailTarget tail{fname, {"this"}};
+        if (cname==mname){ // in constructor
+            mctxt.emit("obj_"+cname+" "+fname+"("+sig+") {");
+            mctxt.begin_function(fn);
+            fn.declare("obj_"+cname, "this", "NULL", "");
+            mctxt.emit_alloc("this", cname);
+            mctxt.emit_setfield("this", "clazz", "the_class_"+cname);
+        } else {
+            mctxt.emit("obj_"+returns+" "+fname+(trampolined ? "_body(" : "(")+sig+") {");
+            mctxt.begin_function(fn);
+            mctxt.add_root("this");
+            mctxt.tail = &tail;
+            fn.signature = c_signature(s, cname, mname);
+        }
+        // Parameters are roots for as long as the method runs
         for (string f: local.formals){
             string internal = "var_"+f;
             mctxt.set_var(f, internal);
+            mctxt.add_root(internal);
+            tail.params.push_back(internal);
         }
-        if (cname==mname){ // in constructor
-            mctxt.emit("obj_"+cname+" new_"+cname+"("+s->emit_full_sig(mctxt,whereami)+") {");
-            mctxt.emit("obj_"+cname+" this = (obj_"+cname+") malloc(sizeof(struct obj_"+cname+"_struct));");
-            mctxt.emit("this->clazz = the_class_"+cname+";");
-            statements_.gen_rval(mctxt, s, whereami);
-            mctxt.emit("return this;");
-        } else {
-            mctxt.emit("obj_"+returns+" "+cname+"_method_"+mname+"("+s->emit_full_sig(mctxt,whereami)+") {");
-            statements_.gen_rval(mctxt, s, whereami);
-            if (returns=="Nothing"){mctxt.emit("return nothing;");}
+        statements_.gen_rval(mctxt, s, whereami);
+        if (cname==mname){
+            mctxt.emit_return("this");
+        } else if (returns=="Nothing"){
+            mctxt.emit_return("nothing");
         }
+        mctxt.end_function();
         mctxt.emit("};");
         mctxt.emit("");
+        if (trampolined){
+            // The entry point makes the tail calls the body leaves pending
+            string actuals = "this";
+            for (string f: local.formals){ actuals += ", var_"+f; }
+            mctxt.emit("obj_"+returns+" "+fname+"("+sig+") {");
+            mctxt.emit("obj_"+returns+" result = "+fname+"_body("+actuals+");");
+            mctxt.emit("if ((obj_Obj) result == QUACK_TAIL_PENDING) { result = (obj_"+returns+") quack_run_tail(); }");
+            mctxt.emit("return result;");
+            mctxt.emit("};");
+            mctxt.emit("");
+        }
         return "";
     }
 
+    void Method::gen_inline(CodegenContext &ctxt, Semantics *s, string cname, string rtype,
+                            vector<string> args, string target){
+        string mname = name_.text_;
+        Whereami whereami(cname, mname);
+        MethodNode local = s->hierarchy[cname].methods[mname];
+        // A constructor builds its object in the result register
+        string self = cname==mname ? target : ctxt.alloc_reg(cname);
+        if (cname==mname){
+            ctxt.emit_alloc(self, cname);
+            ctxt.emit_setfield(self, "clazz", "the_class_"+cname);
+        } else if (rtype!=cname){ // Inherited, so the receiver is converted
+            ctxt.emit_cast(self, cname, args[0]);
+            args.erase(args.begin());
+        } else {
+            ctxt.emit_move(self, args[0]);
+            args.erase(args.begin());
+        }
+        vector<string> fields;
+        for (string v: s->hierarchy[cname].instance_vars){
+            if (v!="this"){ fields.push_back(v); }
+        }
+        string fname = cname==mname ? "new_"+cname : cname+"_method_"+mname;
+        CodegenContext body = ctxt.inline_frame(self, fields, fname, target);
+        for (int i = 0; i < local.formals.size(); i++){
+            string f = local.formals[i];
+            body.bind_var(f, local.types[f], args[i]);
+        }
+        statements_.gen_rval(body, s, whereami);
+        // Falling off the end
+        if (cname!=mname && local.returns=="Nothing"){
+            if (target==""){ body.emit_return("nothing"); }
+            else { body.emit_move(target, "nothing"); }
+        }
+        ctxt.end_inline(body);
+    }
+
+    /* The definition of a method to expand in place of a call to impl's
+     * mname, or null to call it.  Built-in methods are always called; a
+     * method is inlined only if it is small, within the caller's budget,
+     * and not already being expanded (or compiled) here, so recursion
+     * stops.
+     */
+    static Method *inline_candidate(CodegenContext &ctxt, Semantics *s, string impl, string mname,
+                                    int size_limit = -1){
+        IROptions *opts = ctxt.ir_opts;
+        if (size_limit < 0){ size_limit = opts->inline_size; }
+        Method *m = s->hierarchy[impl].methods[mname].ast;
+        if (!opts->inline_calls || m==nullptr){ return nullptr; }
+        string fname = impl==mname ? "new_"+impl : impl+"_method_"+mname;
+        string why;
+        int size = m->size();
+        if (fname==ctxt.function_name()
+                || find(ctxt.inlining.begin(), ctxt.inlining.end(), fname)!=ctxt.inlining.end()){
+            why = "recursive";
+        } else if (ctxt.inlining.size() >= opts->inline_depth){
+            why = "nested "+to_string(ctxt.inlining.size())+" deep";
+        } else if (size > size_limit){
+            why = "size "+to_string(size)+" > "+to_string(size_limit);
+        } else if (ctxt.inlined+size > opts->inline_budget){
+            why = "size "+to_string(size)+", only "+to_string(opts->inline_budget-ctxt.inlined)
+                  +" of budget left";
+        }
+        if (opts->inline_report != nullptr){
+            *opts->inline_report << ctxt.function_name() << ": ";
+            for (string outer: ctxt.inlining){ *opts->inline_report << outer << " > "; }
+            if (why==""){
+                *opts->inline_report << "inlined " << fname << " (size " << size << ", "
+                                     << opts->inline_budget-ctxt.inlined-size << " of budget left)" << endl;
+            } else {
+                *opts->inline_report << "called " << fname << " (" << why << ")" << endl;
+            }
+        }
+        if (why!=""){ return nullptr; }
+        ctxt.inlined += size;
+        return m;
+    }
+
+    void Return::tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found){
+        if (expr_.get_type()!="Call"){ return; }
+        Call *call = (Call*) &expr_;
+        string mname = call->method_.get_name();
+        for (string impl: s->impls(call->receiver_.infer_type(s, whereami), mname)){
+            found.push_back(Whereami(impl, mname));
+        }
+    }
+
+    /* Can a chain of tail calls starting in this method get back to the
+     * C function target?
+     */
+    static bool tail_reaches(Semantics *s, Whereami method, string target, set<string> &seen){
+        Method *m = s->hierarchy[method.classname].methods[method.methodname].ast;
+        string fname = method.classname+"_method_"+method.methodname;
+        if (m==nullptr || seen.count(fname)!=0){ return false; }
+        seen.insert(fname);
+        vector<Whereami> callees;
+        m->statements_.tail_callees(s, method, callees);
+        for (Whereami c: callees){
+            if (c.classname+"_method_"+c.methodname==target || tail_reaches(s, c, target, seen)){
+                return true;
+            }
+        }
+        return false;
+    }
+
     string Return::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (expr_.gen_tail_call(ctxt, s, whereami)){ return ""; }
         string type = expr_.infer_type(s,whereami);
         string target = expr_.gen_rval(ctxt, s, whereami);
-        ctxt.emit("return "+target+";");
+        ctxt.emit_return(target);
         return target;
     }
 
@@ -377,20 +738,31 @@ namespace AST {
         //string vtype = lexpr_.infer_type(s,whereami);
         string vtype = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
         string loc = lexpr_.gen_lval(ctxt, s, whereami);
-        string target = rexpr_.gen_rval(ctxt, s, whereami);
-        ctxt.emit(loc + " = " + target + ";");
+        string target;
+        if (ctxt.is_unboxed(vname)){
+            target = rexpr_.gen_unboxed(ctxt, s, whereami);
+        } else {
+            target = rexpr_.gen_rval(ctxt, s, whereami);
+        }
+        ctxt.emit_move(loc, target);
         return target;
     }
 
     string Construct::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
         string cname = method_.get_name();
-        string toemit = actuals_.gen_lval(ctxt, s, whereami);
+        vector<string> args = actuals_.gen_actuals(ctxt, s, whereami);
         string target = ctxt.alloc_reg(cname);
-        ctxt.emit(target+" = new_"+cname+"("+toemit+"); // Construct");
+        Method *m = inline_candidate(ctxt, s, cname, cname);
+        if (m != nullptr){
+            m->gen_inline(ctxt, s, cname, "", args, target);
+            return target;
+        }
+        ctxt.emit_new(target, cname, args);
         return target;
     }
 
     string Load::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (folded_){ return folded_rval(ctxt); }
         string vname = loc_.get_name();
         //string type = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
         string type = loc_.infer_type(s, whereami);
@@ -402,7 +774,7 @@ namespace AST {
         if (vname=="true"||vname=="false"){
             fullname="lit_"+vname; type="Boolean";
             target = ctxt.alloc_reg("Boolean");
-            ctxt.emit(target+" = "+fullname+"; // Load true/false ");
+            ctxt.emit_move(target, fullname, "Load true/false");
         }
         else {
             fullname = whereami.classname+"_"+whereami.methodname+"_"+vname;
@@ -413,12 +785,57 @@ namespace AST {
         //     cout<<"TYPE: "<<target<<" " <<type<<endl;
         // }
             //ctxt.emit(target+" = "+fullname+"; // Load existing variable ");
-            ctxt.emit(target+" = "+loc+"; // Load existing variable ");
+            if (ctxt.is_unboxed(vname)){
+                ctxt.emit_box(target, type, loc, "Box unboxed variable");
+            } else {
+                ctxt.emit_move(target, loc, "Load existing variable");
+            }
         }
         return target;
     }
 
+    string Load::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (folded_){ return folded_unboxed(); }
+        string vname = loc_.get_name();
+        if (vname=="true"){ return "1"; }
+        if (vname=="false"){ return "0"; }
+        if (ctxt.is_unboxed(vname)){
+            string type = loc_.infer_type(s, whereami);
+            return ctxt.get_var(vname, type);
+        }
+        return ASTNode::gen_unboxed(ctxt, s, whereami);
+    }
+
+    string Call::native_op(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        static map<string,string> int_ops = {
+            {"PLUS", "+"}, {"MINUS", "-"}, {"TIMES", "*"}, {"DIVIDE", "/"},
+            {"LESS", "<"}, {"GREATER", ">"}, {"ATMOST", "<="}, {"ATLEAST", ">="},
+            {"EQUALS", "=="}
+        };
+        string mname = method_.get_name();
+        if (!ctxt.unbox_prims || int_ops.count(mname)==0 || actuals_.elements_.size()!=1){
+            return "";
+        }
+        if (receiver_.infer_type(s, whereami)!="Int"
+                || actuals_.elements_[0]->infer_type(s, whereami)!="Int"){
+            return "";
+        }
+        return int_ops[mname];
+    }
+
+    string Call::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (folded_){ return folded_unboxed(); }
+        string op = native_op(ctxt, s, whereami);
+        if (op==""){ return ASTNode::gen_unboxed(ctxt, s, whereami); }
+        string lv = receiver_.gen_unboxed(ctxt, s, whereami);
+        string rv = actuals_.elements_[0]->gen_unboxed(ctxt, s, whereami);
+        string target = ctxt.alloc_prim_reg();
+        ctxt.emit_prim(target, op, lv, rv);
+        return target;
+    }
+
     string Call::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (folded_){ return folded_rval(ctxt); }
         // if(whereami.classname=="Pt"&&whereami.methodname=="PLUS"){
         //     cout<<"CALL: "<<receiver_.get_type()<<endl;
         // }
@@ -426,26 +843,137 @@ namespace AST {
         //string cname = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
         string mname = method_.get_name();
         string rtype = s->hierarchy[cname].methods[mname].returns;
+        if (native_op(ctxt, s, whereami)!=""){
+            string prim = gen_unboxed(ctxt, s, whereami);
+            string target = ctxt.alloc_reg(rtype);
+            ctxt.emit_box(target, rtype, prim);
+            return target;
+        }
         string target = ctxt.alloc_reg(rtype);
-        string rloc = receiver_.gen_rval(ctxt, s, whereami);
-        string actuals = rloc;
-        if (actuals_.elements_.size()!=0){actuals+=", ";}
-        actuals = actuals + actuals_.gen_lval(ctxt, s, whereami);
-        ctxt.emit(target+" = "+rloc+"->clazz->"+mname+"("+actuals+");");
+        gen_call(ctxt, s, whereami, target);
         return target;
     }
+    // Most implementations guarded at one inline cache before it falls
+    // back to the method table
+    static const int ic_ways = 4;
+    // Most arguments (receiver included) a tail call can hand to the
+    // trampoline (QUACK_TAIL_MAX_ARGS)
+    static const int tail_max_args = 8;
+
+    void Call::gen_call(CodegenContext &ctxt, Semantics *s, Whereami whereami, string target){
+        string cname = receiver_.infer_type(s, whereami);
+        string mname = method_.get_name();
+        string rloc = receiver_.gen_rval(ctxt, s, whereami);
+        vector<string> args = actuals_.gen_actuals(ctxt, s, whereami);
+        args.insert(args.begin(), rloc);
+        vector<string> impls = s->impls(cname, mname);
+        if (impls.size()==1){
+            Method *m = inline_candidate(ctxt, s, impls[0], mname);
+            if (m != nullptr){
+                m->gen_inline(ctxt, s, impls[0], cname, args, target);
+                return;
+            }
+            ctxt.emit_call(target, impls[0]+"_method_"+mname, impls[0], args);
+            return;
+        }
+        // Several candidates are known from the hierarchy, so the inline
+        // cache is filled at compile time; none means just dispatch.
+        if (impls.size()>ic_ways){ impls.resize(ic_ways); }
+        ctxt.emit_dispatch(target, mname, args, impls,
+                           whereami.classname+"."+whereami.methodname+": "+cname+"."+mname);
+    }
+    bool Call::gen_tail_call(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        if (ctxt.tail==nullptr || !ctxt.in_tail_position() || folded_
+                || native_op(ctxt, s, whereami)!=""){
+            return false;
+        }
+        string cname = receiver_.infer_type(s, whereami);
+        string mname = method_.get_name();
+        vector<string> impls = s->impls(cname, mname);
+        // Tail calls other than to the method itself take the trampoline
+        // where musttail is missing, so the method must be compiled for it
+        bool transfers = ctxt.ir_opts->trampolined.count(ctxt.tail->function)!=0
+                && actuals_.elements_.size()+1 <= tail_max_args;
+        if (impls.size()==0){ return false; }
+        if (impls.size()>1){
+            bool user = false;
+            for (string impl: impls){ user = user || s->hierarchy[impl].methods[mname].ast!=nullptr; }
+            if (!transfers || !user){ return false; }
+        }
+        string rloc = receiver_.gen_rval(ctxt, s, whereami);
+        vector<string> args = actuals_.gen_actuals(ctxt, s, whereami);
+        args.insert(args.begin(), rloc);
+        if (impls.size()>1){
+            if (impls.size()>ic_ways){ impls.resize(ic_ways); }
+            ctxt.emit_tail_dispatch(mname, args, impls,
+                                    whereami.classname+"."+whereami.methodname+": "+cname+"."+mname);
+            return true;
+        }
+        string fname = impls[0]+"_method_"+mname;
+        if (fname==ctxt.tail->function){
+            ctxt.emit_tail_jump(cname==impls[0] ? "" : impls[0], args);
+            return true;
+        }
+        // Where tail calls lead back here, expanding them in place (as far
+        // as the budget allows) makes the cycle a loop in this function.
+        set<string> seen;
+        bool cycle = tail_reaches(s, Whereami(impls[0], mname), ctxt.tail->function, seen);
+        Method *m = inline_candidate(ctxt, s, impls[0], mname,
+                                     cycle ? ctxt.ir_opts->inline_budget : -1);
+        if (m != nullptr){
+            m->gen_inline(ctxt, s, impls[0], cname, args, "");
+        } else if (transfers && s->hierarchy[impls[0]].methods[mname].ast!=nullptr){
+            ctxt.emit_tail_call(fname, impls[0], args);
+        } else {
+            string target = ctxt.alloc_reg(s->hierarchy[cname].methods[mname].returns);
+            ctxt.emit_call(target, fname, impls[0], args);
+            ctxt.emit_return(target);
+        }
+        return true;
+    }
+    bool Call::gen_compare(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami){
+        static map<string,string> cmp_ops = {
+            {"LESS", "<"}, {"GREATER", ">"}, {"ATMOST", "<="}, {"ATLEAST", ">="},
+            {"EQUALS", "=="}
+        };
+        string mname = method_.get_name();
+        if (cmp_ops.count(mname)==0 || actuals_.elements_.size()!=1){ return false; }
+        string ltype = receiver_.infer_type(s, whereami);
+        string rtype = actuals_.elements_[0]->infer_type(s, whereami);
+        if (ltype!=rtype){ return false; }
+        if (ltype=="Int"){
+            string lv = receiver_.gen_unboxed(ctxt, s, whereami);
+            string rv = actuals_.elements_[0]->gen_unboxed(ctxt, s, whereami);
+            ctxt.emit_branch(cmp_ops[mname], lv, rv, true_branch, false_branch);
+            return true;
+        }
+        if (ltype=="String"){
+            string lv = receiver_.gen_rval(ctxt, s, whereami);
+            string rv = actuals_.elements_[0]->gen_rval(ctxt, s, whereami);
+            string cmp = ctxt.alloc_prim_reg();
+            if (mname=="EQUALS"){
+                ctxt.emit_call(cmp, "str_equal", "", {lv, rv});
+                ctxt.emit_branch(cmp, true_branch, false_branch);
+            } else {
+                ctxt.emit_call(cmp, "str_compare", "", {lv, rv});
+                ctxt.emit_branch(cmp_ops[mname], cmp, "0", true_branch, false_branch);
+            }
+            return true;
+        }
+        return false;
+    }
+
     void Call::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami){
+        if (folded_){ folded_branch(ctxt, true_branch, false_branch); return; }
+        if (gen_compare(ctxt, true_branch, false_branch, s, whereami)){ return; }
         string cname = receiver_.infer_type(s, whereami);
         string mname = method_.get_name();
         string rtype = s->hierarchy[cname].methods[mname].returns;
         string target = ctxt.alloc_reg(rtype);
-        string rloc = receiver_.gen_rval(ctxt, s, whereami);
-        string actuals = rloc;
-        if (actuals_.elements_.size()!=0){actuals+=", ";}
-        actuals = actuals + actuals_.gen_lval(ctxt, s, whereami);
-        ctxt.emit(target+" = "+rloc+"->clazz->"+mname+"("+actuals+");");
-        ctxt.emit(string("if (") + target + "->value) goto " + true_branch + ";");
-        ctxt.emit(string("goto ") + false_branch + ";");
+        gen_call(ctxt, s, whereami, target);
+        string cond = ctxt.alloc_prim_reg();
+        ctxt.emit_unbox(cond, target);
+        ctxt.emit_branch(cond, true_branch, false_branch);
     }
 
     string If::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
@@ -455,12 +983,12 @@ namespace AST {
         cond_.gen_branch(ctxt, thenpart, elsepart, s, whereami);
 
         string target = ctxt.alloc_reg("Boolean");
-        ctxt.emit(thenpart + ": ;");
+        ctxt.emit_label(thenpart);
         truepart_.gen_rval(ctxt, s, whereami);
-        ctxt.emit(string("goto ") + endpart + ";");
-        ctxt.emit(elsepart + ": ;");
+        ctxt.emit_jump(endpart);
+        ctxt.emit_label(elsepart);
         falsepart_.gen_rval(ctxt, s, whereami);
-        ctxt.emit(endpart + ": ;");
+        ctxt.emit_label(endpart);
         return target;
     }
 
@@ -470,32 +998,112 @@ namespace AST {
         cond_.gen_branch(ctxt, truepart, endpart, s, whereami);
         
         string target = ctxt.alloc_reg("Boolean");
-        ctxt.emit(truepart + ": ;");
+        ctxt.emit_label(truepart);
         string b = body_.gen_rval(ctxt, s, whereami);
         cond_.gen_branch(ctxt, truepart, endpart, s, whereami);
-        ctxt.emit(string("goto ")+truepart+";");
-        ctxt.emit(endpart + ": ;");
+        ctxt.emit_label(endpart);
         return target;
     }
 
-    void Load::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami){
-        string vname = loc_.get_name();
-        string type = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
-        //string type = loc_.infer_type(s, whereami);
-        string fullname;
-        string target = ctxt.alloc_reg(type);
-        if (vname=="true"||vname=="false"){
-            fullname="lit_"+vname; type="Boolean";
-            ctxt.emit(target+" = "+fullname+"; // Load true/false ");
+    /* The alternative taken for each class the value might belong to,
+     * the first whose class contains it, is found here; at run time a
+     * switch on the value's class id goes straight to it.  Class ids are
+     * in preorder, so each alternative takes a few runs of consecutive
+     * ids, bounded by the first and last ids of the alternatives' classes.
+     */
+    string Typecase::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+        string type = expr_.infer_type(s, whereami);
+        string value = expr_.gen_rval(ctxt, s, whereami);
+        if (!IRInstr::is_var(value)){
+            string reg = ctxt.alloc_reg(type);
+            ctxt.emit_move(reg, value);
+            value = reg;
         }
-        else {
-            fullname = whereami.classname+"_"+whereami.methodname+"_"+vname;
-            type = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
-            string loc = ctxt.get_var(fullname, type);
-            ctxt.emit(target+" = "+loc+"; // Load existing variable ");
+        vector<Type_Alternative *> &alts = cases_.elements_;
+        vector<string> labels;
+        for (int a = 0; a < alts.size(); a++){ labels.push_back(ctxt.new_branch_label("case")); }
+        string endpart = ctxt.new_branch_label("endcase");
+
+        int first = 0;
+        int last = s->all_types.size() - 1;
+        TypeId t = s->type_id(type);
+        if (t >= 0){
+            first = t;
+            last = s->types[t]->last_descendant;
+        }
+        // Where the runs of ids start
+        vector<TypeId> alt_ids;
+        set<int> starts = {first};
+        for (Type_Alternative *alt: alts){
+            TypeId c = s->type_id(alt->classname_.get_name());
+            alt_ids.push_back(c);
+            if (c <= last && s->types[c]->last_descendant >= first){
+                starts.insert(max(c, first));
+                if (s->types[c]->last_descendant < last){ starts.insert(s->types[c]->last_descendant + 1); }
+            }
+        }
+        vector<SwitchCase> runs;
+        map<string, int> count;
+        for (set<int>::iterator at = starts.begin(); at != starts.end(); at++){
+            set<int>::iterator next = at;
+            next++;
+            int high = next == starts.end() ? last : *next - 1;
+            string target = endpart;
+            for (int a = 0; a < alts.size(); a++){
+                if (alt_ids[a] <= *at && *at <= s->types[alt_ids[a]]->last_descendant){ target = labels[a]; break; }
+            }
+            if (!runs.empty() && runs.back().target == target){
+                runs.back().high = high;
+            } else {
+                runs.push_back({*at, high, target});
+                count[target]++;
+            }
+        }
+        // The target with the most runs needs no cases of its own
+        string common = endpart;
+        map<string, int>::iterator end = count.find(endpart);
+        int most = end == count.end() ? 0 : end->second;
+        for (auto &c: count){
+            if (c.second > most){ common = c.first; most = c.second; }
+        }
+        if (count.size() == 1){
+            ctxt.emit_jump(common);
+        } else {
+            vector<SwitchCase> others;
+            for (SwitchCase &r: runs){
+                if (r.target != common){ others.push_back(r); }
+            }
+            string id = ctxt.alloc_prim_reg();
+            ctxt.emit_move(id, value+"->clazz->id");
+            ctxt.emit_switch(id, others, common);
+        }
+        for (int a = 0; a < alts.size(); a++){
+            ctxt.emit_label(labels[a]);
+            alts[a]->gen_bind(ctxt, s, whereami, value);
+            alts[a]->block_.gen_rval(ctxt, s, whereami);
+            ctxt.emit_jump(endpart);
         }
-        ctxt.emit(string("if (") + target + "->value) goto " + true_branch + ";");
-        ctxt.emit(string("goto ") + false_branch + ";");
+        ctxt.emit_label(endpart);
+        return "nothing";
+    }
+
+    void Type_Alternative::gen_bind(CodegenContext &ctxt, Semantics *s, Whereami whereami, string value){
+        string vname = ident_.get_name();
+        string vtype = s->hierarchy[whereami.classname].methods[whereami.methodname].types[vname];
+        string loc = ctxt.get_var(vname, vtype);
+        if (ctxt.is_unboxed(vname)){
+            string obj = ctxt.alloc_reg(vtype);
+            ctxt.emit_cast(obj, vtype, value);
+            ctxt.emit_unbox(loc, obj);
+        } else {
+            ctxt.emit_cast(loc, vtype, value);
+        }
+    }
+
+    void Load::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami){
+        if (folded_){ folded_branch(ctxt, true_branch, false_branch); return; }
+        string cond = gen_unboxed(ctxt, s, whereami);
+        ctxt.emit_branch(cond, true_branch, false_branch);
     }
 
 
@@ -516,7 +1124,7 @@ namespace AST {
         return ctxt.get_var(vname,vtype);
     }
 
-    string Actuals::gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
+    vector<string> Actuals::gen_actuals(CodegenContext &ctxt, Semantics *s, Whereami whereami){
         vector<string> locs;
         for (Expr *a: elements_){
             string type = a->infer_type(s, whereami);
@@ -525,87 +1133,128 @@ namespace AST {
             string loc = a->gen_rval(ctxt, s, whereami);
             locs.push_back(loc);
         }
-        string toemit;
-        for (string l: locs){
-            toemit = toemit+l+", ";
+        return locs;
+    }
+
+    /* The value of a and b (a or b) in a C int: the left operand's
+     * value, unless it is true (false), in which case the right operand
+     * is evaluated for the value instead.
+     */
+    static string short_circuit(CodegenContext &ctxt, Semantics *s, Whereami whereami,
+                                ASTNode &left, ASTNode &right, bool is_and){
+        string target = ctxt.alloc_prim_reg();
+        string right_part = ctxt.new_branch_label(is_and ? "and" : "or");
+        string endpart = ctxt.new_branch_label(is_and ? "endand" : "endor");
+        ctxt.emit_move(target, left.gen_unboxed(ctxt, s, whereami));
+        if (is_and) {
+            ctxt.emit_branch(target, right_part, endpart);
+        } else {
+            ctxt.emit_branch(target, endpart, right_part);
         }
-        if (locs.size()!=0){toemit = toemit.substr(0, toemit.size()-2);}
-        return toemit;
+        ctxt.emit_label(right_part);
+        ctxt.emit_move(target, right.gen_unboxed(ctxt, s, whereami));
+        ctxt.emit_label(endpart);
+        return target;
     }
 
-    string And::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
-        string lv = left_.gen_rval(ctxt, s, whereami);
-        string rv = right_.gen_rval(ctxt, s, whereami);
+    /* A boxed Boolean for a condition, by branching on it */
+    static string branch_value(CodegenContext &ctxt, Semantics *s, Whereami whereami, ASTNode &cond){
         string target = ctxt.alloc_reg("Boolean");
-
         string thenpart = ctxt.new_branch_label("then");
         string elsepart = ctxt.new_branch_label("else");
         string endpart = ctxt.new_branch_label("endif");
-        ctxt.emit(string("if (")+lv+"->value && "+rv+"->value) goto "+thenpart+";");
-        ctxt.emit(string("goto ")+elsepart+";");
-        ctxt.emit(thenpart+": ;");
-        ctxt.emit(target+" = lit_true;");
-        ctxt.emit(string("goto ")+endpart+";");
-        ctxt.emit(elsepart+": ;");
-        ctxt.emit(target+" = lit_false;");
-        ctxt.emit(endpart + ": ;");
-        ctxt.free_reg(lv);
-        ctxt.free_reg(rv);
+        cond.gen_branch(ctxt, thenpart, elsepart, s, whereami);
+        ctxt.emit_label(thenpart);
+        ctxt.emit_move(target, "lit_true");
+        ctxt.emit_jump(endpart);
+        ctxt.emit_label(elsepart);
+        ctxt.emit_move(target, "lit_false");
+        ctxt.emit_label(endpart);
         return target;
     }
+
+    string And::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (folded_){ return folded_unboxed(); }
+        if (!ctxt.unbox_prims){ return ASTNode::gen_unboxed(ctxt, s, whereami); }
+        return short_circuit(ctxt, s, whereami, left_, right_, true);
+    }
+    string And::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (folded_){ return folded_rval(ctxt); }
+        if (ctxt.unbox_prims){
+            string prim = gen_unboxed(ctxt, s, whereami);
+            string target = ctxt.alloc_reg("Boolean");
+            ctxt.emit_box(target, "Boolean", prim);
+            return target;
+        }
+        return branch_value(ctxt, s, whereami, *this);
+    }
     void And::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) {
+        if (folded_){ folded_branch(ctxt, true_branch, false_branch); return; }
         string right_part = ctxt.new_branch_label("and");
         left_.gen_branch(ctxt, right_part, false_branch, s, whereami);
-        ctxt.emit(right_part + ": ;");
+        ctxt.emit_label(right_part);
         right_.gen_branch(ctxt, true_branch, false_branch, s, whereami);
     }
 
+    string Or::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (folded_){ return folded_unboxed(); }
+        if (!ctxt.unbox_prims){ return ASTNode::gen_unboxed(ctxt, s, whereami); }
+        return short_circuit(ctxt, s, whereami, left_, right_, false);
+    }
     string Or::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
-        string lv = left_.gen_rval(ctxt, s, whereami);
-        string rv = right_.gen_rval(ctxt, s, whereami);
-        string target = ctxt.alloc_reg("Boolean");
-
-        string thenpart = ctxt.new_branch_label("then");
-        string elsepart = ctxt.new_branch_label("else");
-        string endpart = ctxt.new_branch_label("endif");
-        ctxt.emit(string("if (")+lv+"->value || "+rv+"->value) goto "+thenpart+";");
-        ctxt.emit(string("goto ")+elsepart+";");
-        ctxt.emit(thenpart+": ;");
-        ctxt.emit(target+" = lit_true;");
-        ctxt.emit(string("goto ")+endpart+";");
-        ctxt.emit(elsepart+": ;");
-        ctxt.emit(target+" = lit_false;");
-        ctxt.emit(endpart + ": ;");
-        ctxt.free_reg(lv);
-        ctxt.free_reg(rv);
-        return target;
+        if (folded_){ return folded_rval(ctxt); }
+        if (ctxt.unbox_prims){
+            string prim = gen_unboxed(ctxt, s, whereami);
+            string target = ctxt.alloc_reg("Boolean");
+            ctxt.emit_box(target, "Boolean", prim);
+            return target;
+        }
+        return branch_value(ctxt, s, whereami, *this);
     }
     void Or::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) {
+        if (folded_){ folded_branch(ctxt, true_branch, false_branch); return; }
         string right_part = ctxt.new_branch_label("or");
         left_.gen_branch(ctxt, true_branch, right_part, s, whereami);
-        ctxt.emit(right_part + ": ;");
+        ctxt.emit_label(right_part);
         right_.gen_branch(ctxt, true_branch, false_branch, s, whereami);
     }
 
+    string Not::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (folded_){ return folded_unboxed(); }
+        if (!ctxt.unbox_prims){ return ASTNode::gen_unboxed(ctxt, s, whereami); }
+        string lv = left_.gen_unboxed(ctxt, s, whereami);
+        string target = ctxt.alloc_prim_reg();
+        ctxt.emit_not(target, lv);
+        return target;
+    }
     string Not::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (folded_){ return folded_rval(ctxt); }
+        if (ctxt.unbox_prims){
+            string prim = gen_unboxed(ctxt, s, whereami);
+            string target = ctxt.alloc_reg("Boolean");
+            ctxt.emit_box(target, "Boolean", prim);
+            return target;
+        }
         string lv = left_.gen_rval(ctxt, s, whereami);
         string target = ctxt.alloc_reg("Boolean");
 
         string thenpart = ctxt.new_branch_label("then");
         string elsepart = ctxt.new_branch_label("else");
         string endpart = ctxt.new_branch_label("endif");
-        ctxt.emit(string("if (!")+lv+"->value) goto "+thenpart+";");
-        ctxt.emit(string("goto ")+elsepart+";");
-        ctxt.emit(thenpart+": ;");
-        ctxt.emit(target+" = lit_true;");
-        ctxt.emit(string("goto ")+endpart+";");
-        ctxt.emit(elsepart+": ;");
-        ctxt.emit(target+" = lit_false;");
-        ctxt.emit(endpart + ": ;");
+        string lp = ctxt.alloc_prim_reg();
+        ctxt.emit_unbox(lp, lv);
+        ctxt.emit_branch(lp, elsepart, thenpart);
+        ctxt.emit_label(thenpart);
+        ctxt.emit_move(target, "lit_true");
+        ctxt.emit_jump(endpart);
+        ctxt.emit_label(elsepart);
+        ctxt.emit_move(target, "lit_false");
+        ctxt.emit_label(endpart);
         ctxt.free_reg(lv);
         return target;
     }
     void Not::gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) {
+        if (folded_){ folded_branch(ctxt, true_branch, false_branch); return; }
         left_.gen_branch(ctxt, false_branch, true_branch, s, whereami);
     }
 
@@ -624,22 +1273,26 @@ namespace AST {
     string IntConst::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
         //if(target_reg==""){target_reg = ctxt.alloc_reg("Int");}
         string target = ctxt.alloc_reg("Int");
-        ctxt.emit(target + " = int_literal(" + to_string(value_) + ");");
+        ctxt.emit_move(target, ctxt.int_const(value_));
         return target;
         //ctxt.emit(target_reg + " = int_literal(" + to_string(value_) + ");");
     }
     string IntConst::gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
-        return "int_literal("+to_string(value_)+")";
+        return ctxt.int_const(value_);
+    }
+    string IntConst::gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+        if (value_ < 0){ return "(" + to_string(value_) + ")"; }
+        return to_string(value_);
     }
 
     string StrConst::gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
         //if(target_reg==""){target_reg = ctxt.alloc_reg("String");}
         string target = ctxt.alloc_reg("String");
-        ctxt.emit(target + " = str_literal(\"" + value_ + "\");");
+        ctxt.emit_move(target, ctxt.str_const(value_));
         return target;
     }
     string StrConst::gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
-        return "str_literal(\""+value_+"\")";
+        return ctxt.str_const(value_);
     }
 
 
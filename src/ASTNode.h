@@ -14,6 +14,7 @@
 #include <iostream>
 #include "CodegenContext.h"
 #include "EvalContext.h"
+#include "Symbols.h"
 
 using namespace std;
 
@@ -47,7 +48,15 @@ namespace AST {
         virtual string get_type(){return "ASTNode";}
         virtual string get_name(){return "";}
         virtual string infer_type(Semantics *s, Whereami whereami){return "TOP";}
+        // Constant folding: 1 if this is an expression whose value is
+        // known at compile time, with the value left in ctxt.value.
+        // Statements fold the expressions within them and return 0.
         virtual int eval(EvalContext &ctxt){return 0;}//immediate eval
+        // Count the assignments to each variable in a method body
+        virtual void count_assigns(map<string,int> &assigns){}
+        // Number of nodes in the tree, the measure of a method body
+        // when deciding whether to inline it
+        virtual int size(){return 1;}
         virtual string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami){
             cerr << "*** No rvalue for this node ***" << endl; exit(1);//assert(false);
             return "";
@@ -55,13 +64,27 @@ namespace AST {
         virtual string gen_lval(CodegenContext &ctx, Semantics *s, Whereami whereami) {
             cerr << "*** No lvalue for this node ***" << endl; exit(1);//assert(false);
         }
+        // C int holding the primitive value of an Int or Boolean
+        // expression.  By default, evaluate boxed and take the hidden field.
+        virtual string gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) {
+            string boxed = gen_rval(ctxt, s, whereami);
+            string target = ctxt.alloc_prim_reg();
+            ctxt.emit_unbox(target, boxed);
+            return target;
+        }
         virtual void gen_branch(CodegenContext &ctx, string true_branch, string false_branch, Semantics *s, Whereami whereami) {
             cerr << "*** No branching on this node ****" << endl; exit(1);//assert(false);
         }
+        // Return the value of this expression from the method, if it is
+        // a call that can be made without growing the stack; false
+        // (having emitted nothing) to return it in the ordinary way.
+        virtual bool gen_tail_call(CodegenContext &ctxt, Semantics *s, Whereami whereami) { return false; }
+        // Methods that a call in tail position may reach (each candidate)
+        virtual void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) {}
         virtual void emit_obj(CodegenContext &ctxt, Semantics *s, Whereami whereami){
             cerr << "*** No emit_obj for this node ***" << endl; exit(1);
         };
-        virtual int init_check(vector<string> *init){return 1;}
+        virtual int init_check(Names *init){return 1;}
         virtual void json(ostream& out, AST_print_context& ctx){;}
         string str() {
             stringstream ss;
@@ -80,7 +103,7 @@ namespace AST {
     public:
         string name_;
         string get_type() override {return "Stub";}
-        int init_check(vector<string> *init) override { return 1; }
+        int init_check(Names *init) override { return 1; }
         explicit Stub(string name) : name_{name} {}
         void json(ostream& out, AST_print_context& ctx) override;
     };
@@ -103,7 +126,7 @@ namespace AST {
         string kind_;
         vector<Kind *> elements_;
         string get_type() override {return kind_;}
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             for (Kind *el: elements_){
                 if (!el->init_check(init)){return 0;}
             }
@@ -113,6 +136,21 @@ namespace AST {
             for (Kind *el: elements_){ el->infer_type(s, whereami); }
             return kind_; 
         }
+        int eval(EvalContext &ctxt) override {
+            for (Kind *el: elements_){ el->eval(ctxt); }
+            return 0;
+        }
+        void count_assigns(map<string,int> &assigns) override {
+            for (Kind *el: elements_){ el->count_assigns(assigns); }
+        }
+        int size() override {
+            int n = 0;
+            for (Kind *el: elements_){ n += el->size(); }
+            return n;
+        }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override {
+            for (Kind *el: elements_){ el->tail_callees(s, whereami, found); }
+        }
         //string gen_rval(CodegenContext& ctxt, string target_reg, Semantics *s, Whereami whereami) override {
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override {
             for (Kind *el: elements_) {
@@ -168,12 +206,13 @@ namespace AST {
     class Ident : public LExpr {
     public:
         string text_;
+        Symbol sym_; // text_, interned
         string get_type() override {return "Ident";}
         string get_name() override {return this->text_;}
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             // but what if calling ll in class with this.ll
             if (text_=="true"||text_=="false"){return 1;}
-            if (find(init->begin(), init->end(), text_)==init->end()){
+            if (!init->contains(sym_)){
                 cerr<<"Instantiation error: Variable "<<text_<<" not instantiated!"<<endl; 
                 return 0;
             }
@@ -182,7 +221,7 @@ namespace AST {
         string infer_type(Semantics *s, Whereami whereami) override;
         //string gen_rval(CodegenContext& ctxt, string target_reg, Semantics *s, Whereami whereami) override;
         string gen_lval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
-        explicit Ident(string txt) : text_{txt} {}
+        explicit Ident(string txt) : text_{txt}, sym_{symbols().intern(txt)} {}
         void json(ostream& out, AST_print_context& ctx) override;
     };
 
@@ -227,7 +266,13 @@ namespace AST {
         string get_type() override {return "Method";}
         // init_check not defined because manually iterating
         string infer_type(Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override;
+        int size() override { return statements_.size(); }
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
+        // Expand the body in place of a call (args[0] being the receiver,
+        // of static type rtype) or of a constructor (cname==name_).
+        void gen_inline(CodegenContext &ctxt, Semantics *s, string cname, string rtype,
+                        vector<string> args, string target);
         explicit Method(Ident& name, Formals& formals, Ident& returns, Block& statements) :
           name_{name}, formals_{formals}, returns_{returns}, statements_{statements} {}
         void json(std::ostream& out, AST_print_context&ctx) override;
@@ -253,7 +298,7 @@ namespace AST {
     class Statement : public ASTNode { 
     public:
         std::string get_type() override {return "Statement";}
-        int init_check(std::vector<std::string> *init) override {return 1;}
+        int init_check(Names *init) override {return 1;}
     };
 
     class Assign : public Statement {
@@ -261,16 +306,16 @@ namespace AST {
         ASTNode &lexpr_;
         ASTNode &rexpr_;
         string get_type() override {return "Assign";}
-        int init_check(vector<string> *init) override {
+        int eval(EvalContext &ctxt) override;
+        void count_assigns(map<string,int> &assigns) override { assigns[lexpr_.get_name()]++; }
+        int size() override { return 1 + rexpr_.size(); }
+        int init_check(Names *init) override {
             int success = rexpr_.init_check(init);
             if (!success){
                 cerr<<"Instantiation error: RHS of Assign statement not defined."<<endl;
                 return 0;
             }
-            string lhs = lexpr_.get_name();
-            if (find(init->begin(), init->end(), lhs)==init->end()){
-                init->push_back(lhs);
-            }
+            init->insert(lexpr_.get_name());
             return 1;
         }
         string infer_type(Semantics *s, Whereami whereami) override;
@@ -284,15 +329,15 @@ namespace AST {
     public:
         Ident &static_type_;
         std::string get_type() override {return "AssignDeclare";}
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             int success = rexpr_.init_check(init);
             if (!success){
                 cerr<<"Instantiation error: RHS of AssignDeclare statement not defined."<<endl;
                 return 0;
             }
             string lhs = lexpr_.get_name();
-            if (find(init->begin(), init->end(), lhs)==init->end()){
-                init->push_back(lhs);
+            if (!init->contains(lhs)){
+                init->insert(lhs);
             } else {
                 cerr<<"Instantiation error: In AssignDeclare. Variable "<<lhs<<" already defined."<<endl;
                 return 0;
@@ -313,6 +358,16 @@ namespace AST {
     class Expr : public Statement {
     public:
         std::string get_type() override {return "Expr";} 
+        // Set by eval when the value is known at compile time; code
+        // generation then uses the constant instead of the expression.
+        ConstValue *folded_ = nullptr;
+        int fold(EvalContext &ctxt) {
+            folded_ = new ConstValue(ctxt.value);
+            return 1;
+        }
+        string folded_rval(CodegenContext &ctxt);
+        string folded_unboxed() { return to_string(folded_->num); }
+        void folded_branch(CodegenContext &ctxt, string true_branch, string false_branch);
     };
 
     /* When an expression is an LExpr, we
@@ -324,12 +379,14 @@ namespace AST {
         LExpr &loc_;
         std::string get_type() override {return "Load";}
         std::string get_name() override { return loc_.get_name(); }
-        int init_check(std::vector<std::string> *init) override {
+        int eval(EvalContext &ctxt) override;
+        int init_check(Names *init) override {
             return loc_.init_check(init);
         }
         string infer_type(Semantics *s, Whereami whereami) override;
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         string gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         void gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) override;
         Load(LExpr &loc) : loc_{loc} {}
         void json(std::ostream &out, AST_print_context &ctx) override;
@@ -342,11 +399,14 @@ namespace AST {
     public:
         ASTNode &expr_;
         std::string get_type() override {return "Return";}
-        int init_check(std::vector<std::string> *init) override {
+        int init_check(Names *init) override {
             int s = expr_.init_check(init);
             return s;
         }
         string infer_type(Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override { expr_.eval(ctxt); return 0; }
+        int size() override { return 1 + expr_.size(); }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override;
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
         explicit Return(ASTNode& expr) : expr_{expr}  {}
         void json(std::ostream& out, AST_print_context& ctx) override;
@@ -358,41 +418,50 @@ namespace AST {
         Seq<ASTNode> &truepart_; // Execute this block if the condition is true
         Seq<ASTNode> &falsepart_; // Execute this block if the condition is false
         std::string get_type() override {return "If";}
-        int init_check(std::vector<std::string> *init) override {
+        int init_check(Names *init) override {
             int c = cond_.init_check(init);
             if (!c){
                 cerr<<"Instantiation error: in if condition."<<endl;
                 return 0; //condition is ill-defined
             }
-            std::vector<std::string> ti = (*init);
+            Names ti = (*init);
             if (!truepart_.init_check(&ti)){ //vars in truepart not defined
                 cerr<<"Instantiation error: in true part of if."<<endl;return 0;
             }
             
-            std::vector<std::string> fi = (*init);
+            Names fi = (*init);
             if (!falsepart_.init_check(&fi)){ //vars in falsepart not defined
                 cerr<<"Instantiation error: in false part of if."<<endl;return 0;
             }
             
-            for (std::string v: ti){
-                if (std::find(fi.begin(), fi.end(), v)==fi.end()){ 
+            for (Symbol v: ti.own()){
+                if (!fi.contains(v)){ 
                     cerr<<"Instantiation error: Inconsistent variables defined in true&false part of if."<<endl;
                     return 0; 
                 }
-                if (std::find(init->begin(), init->end(), v)==init->end()){
-                    init->push_back(v); }
+                init->insert(v);
             }
-            for (std::string v: fi){
-                if (std::find(ti.begin(), ti.end(), v)==ti.end()){ 
+            for (Symbol v: fi.own()){
+                if (!ti.contains(v)){ 
                     cerr<<"Instantiation error: Inconsistent variables defined in true&false part of if."<<endl;
                     return 0; 
                 }
-                if (std::find(init->begin(), init->end(), v)==init->end()){
-                    init->push_back(v); }
+                init->insert(v);
             }
             return 1;
         }
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override {
+            cond_.eval(ctxt); truepart_.eval(ctxt); falsepart_.eval(ctxt);
+            return 0;
+        }
+        void count_assigns(map<string,int> &assigns) override {
+            truepart_.count_assigns(assigns); falsepart_.count_assigns(assigns);
+        }
+        int size() override { return 1 + cond_.size() + truepart_.size() + falsepart_.size(); }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override {
+            truepart_.tail_callees(s, whereami, found); falsepart_.tail_callees(s, whereami, found);
+        }
         explicit If(ASTNode& cond, Seq<ASTNode>& truepart, Seq<ASTNode>& falsepart) :
             cond_{cond}, truepart_{truepart}, falsepart_{falsepart} { };
         string infer_type(Semantics *s, Whereami whereami) override;
@@ -404,17 +473,23 @@ namespace AST {
         ASTNode& cond_;  // Loop while this condition is true
         Seq<ASTNode>&  body_;     // Loop body
         std::string get_type() override {return "While";}
-        int init_check(std::vector<std::string> *init) override {
+        int init_check(Names *init) override {
             int c = cond_.init_check(init);
             if (!c){
                 cerr<<"Instantiation error: in while loop condition."<<endl;
                 return 0; //condition is ill-defined
             }
-            std::vector<std::string> tmp = (*init);
+            Names tmp = (*init);
             return body_.init_check(&tmp);;
         }
         string infer_type(Semantics *s, Whereami whereami) override;
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override { cond_.eval(ctxt); body_.eval(ctxt); return 0; }
+        void count_assigns(map<string,int> &assigns) override { body_.count_assigns(assigns); }
+        int size() override { return 1 + cond_.size() + body_.size(); }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override {
+            body_.tail_callees(s, whereami, found);
+        }
         explicit While(ASTNode& cond, Block& body) :
             cond_{cond}, body_{body} { };
         void json(std::ostream& out, AST_print_context& ctx) override;
@@ -439,6 +514,13 @@ namespace AST {
         string infer_type(Semantics *s, Whereami whereami) override;
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
         void emit_obj(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        // Declare the C functions for the constructor and the methods
+        // defined (not inherited) here
+        void emit_prototypes(CodegenContext &ctxt, Semantics *s, Whereami whereami);
+        int eval(EvalContext &ctxt) override {
+            constructor_.eval(ctxt); methods_.eval(ctxt);
+            return 0;
+        }
         explicit Class(Ident& name, Ident& super,
                  Method& constructor, Methods& methods) :
             name_{name},  super_{super},
@@ -458,12 +540,18 @@ namespace AST {
     public:
         int value_;
         string get_type() override { return "IntConst";}
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
+            return 1;
+        }
+        int eval(EvalContext &ctxt) override {
+            ctxt.value = ConstValue();
+            ctxt.value.type = "Int"; ctxt.value.num = value_;
             return 1;
         }
         string infer_type(Semantics *s, Whereami whereami) override;
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         string gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         explicit IntConst(int v) : value_{v} {}
         void json(std::ostream& out, AST_print_context& ctx) override;
     };
@@ -474,6 +562,18 @@ namespace AST {
         Ident& classname_;
         Block& block_;
         std::string get_type() override { return "Type_Alternative";}
+        int eval(EvalContext &ctxt) override { block_.eval(ctxt); return 0; }
+        void count_assigns(map<string,int> &assigns) override {
+            assigns[ident_.get_name()]++;
+            block_.count_assigns(assigns);
+        }
+        int size() override { return 1 + block_.size(); }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override {
+            block_.tail_callees(s, whereami, found);
+        }
+        string infer_type(Semantics *s, Whereami whereami) override;
+        // Bind the variable to value, converted to this alternative's class
+        void gen_bind(CodegenContext &ctxt, Semantics *s, Whereami whereami, string value);
         explicit Type_Alternative(Ident& ident, Ident& classname, Block& block) :
                 ident_{ident}, classname_{classname}, block_{block} {}
         void json(std::ostream& out, AST_print_context& ctx) override;
@@ -489,8 +589,30 @@ namespace AST {
         Expr& expr_; // An expression we want to downcast to a more specific class
         Type_Alternatives& cases_;    // A case for each potential type
         std::string get_type() override {return "Typecase";}
-        int init_check(vector<string> *init) override {
-            return 1; // TODO
+        int init_check(Names *init) override {
+            if (!expr_.init_check(init)){
+                cerr<<"Instantiation error: in typecase expression."<<endl;
+                return 0;
+            }
+            // No alternative need run, so none defines anything after
+            for (Type_Alternative *alt: cases_.elements_){
+                Names ai = (*init);
+                ai.insert(alt->ident_.sym_);
+                if (!alt->block_.init_check(&ai)){
+                    cerr<<"Instantiation error: in typecase alternative "<<alt->ident_.get_name()<<": "
+                        <<alt->classname_.get_name()<<"."<<endl;
+                    return 0;
+                }
+            }
+            return 1;
+        }
+        string infer_type(Semantics *s, Whereami whereami) override;
+        string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override { expr_.eval(ctxt); cases_.eval(ctxt); return 0; }
+        void count_assigns(map<string,int> &assigns) override { cases_.count_assigns(assigns); }
+        int size() override { return 1 + expr_.size() + cases_.size(); }
+        void tail_callees(Semantics *s, Whereami whereami, vector<Whereami> &found) override {
+            cases_.tail_callees(s, whereami, found);
         }
         explicit Typecase(Expr& expr, Type_Alternatives& cases) :
                 expr_{expr}, cases_{cases} {};
@@ -502,7 +624,12 @@ namespace AST {
     public:
         string value_;
         string get_type() override {return "StrConst";}
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
+            return 1;
+        }
+        int eval(EvalContext &ctxt) override {
+            ctxt.value = ConstValue();
+            ctxt.value.type = "String"; ctxt.value.text = value_;
             return 1;
         }
         explicit StrConst(std::string v) : value_{v} {}
@@ -514,7 +641,8 @@ namespace AST {
 
     class Actuals : public Seq<Expr> {
     public:
-        string gen_lval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        // Evaluate each argument, returning where the values are
+        vector<string> gen_actuals(CodegenContext &ctxt, Semantics *s, Whereami whereami);
         explicit Actuals() : Seq("Actuals") {}
     };
 
@@ -528,14 +656,16 @@ namespace AST {
         Ident&  method_;           /* Method name is same as class name */
         Actuals& actuals_;    /* Actual arguments to constructor */
         std::string get_type() override {return "Construct";}
-        int init_check(vector<string> *init) override{
-            if (std::find(init->begin(), init->end(), method_.text_)==init->end()){
+        int init_check(Names *init) override{
+            if (!init->contains(method_.sym_)){
                 cerr << "Instantiation error: Couldnt find constructor "<<method_.text_<<"!"<<endl;
                 return 0; // check method_.text_ not in init vars
             }
             return actuals_.init_check(init);
         }
         string infer_type(Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override { actuals_.eval(ctxt); return 0; }
+        int size() override { return 1 + actuals_.size(); }
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         explicit Construct(Ident& method, Actuals& actuals) :
                 method_{method}, actuals_{actuals} {}
@@ -553,7 +683,9 @@ namespace AST {
         Ident& method_;         /* Identifier of the method */
         Actuals& actuals_;     /* List of actual arguments */
         std::string get_type() override {return "Call";}
-        int init_check(vector<string> *init) override{
+        int eval(EvalContext &ctxt) override;
+        int size() override { return folded_ ? 1 : 1 + receiver_.size() + actuals_.size(); }
+        int init_check(Names *init) override{
             int s1 = receiver_.init_check(init);
             int s2 = method_.init_check(init);
             int s3 = actuals_.init_check(init);
@@ -565,9 +697,26 @@ namespace AST {
         }
         string infer_type(Semantics *s, Whereami whereami) override;
         string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         void gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) override;
         explicit Call(Expr& receiver, Ident& method, Actuals& actuals) :
                 receiver_{receiver}, method_{method}, actuals_{actuals} {};
+        // C operator for an Int method we can compute unboxed, or "" if
+        // this call has to go through the method table.
+        string native_op(CodegenContext &ctxt, Semantics *s, Whereami whereami);
+        // For an Int or String comparison, emit the operands and a branch
+        // on the result; false if this call has to be dispatched.
+        bool gen_compare(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami);
+        // Emit the call, leaving its result in target: a direct call when
+        // class hierarchy analysis finds a unique implementation, else an
+        // inline cache of guarded direct calls before the method table.
+        void gen_call(CodegenContext &ctxt, Semantics *s, Whereami whereami, string target);
+        // A call in tail position: to the method itself, a jump back to
+        // its start; inlined, returning from the method within the
+        // inlined body; or, if the method is compiled for the trampoline,
+        // a tail call, guarded by an inline cache where there are
+        // several candidates.
+        bool gen_tail_call(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
         // Convenience factory for the special case of a method
         // created for a binary operator (+, -, etc).
         static Call* binop(std::string opname, Expr& receiver, Expr& arg);
@@ -585,6 +734,7 @@ namespace AST {
         ASTNode &left_;
         ASTNode &right_;
         std::string get_type() override {return "BinOp";}
+        int size() override { return folded_ ? 1 : 1 + left_.size() + right_.size(); }
         BinOp(std::string sym, ASTNode &l, ASTNode &r) :
                 opsym{sym}, left_{l}, right_{r} {};
         void json(std::ostream& out, AST_print_context& ctx) override;
@@ -593,8 +743,9 @@ namespace AST {
    class And : public BinOp {
    public:
         std::string get_type() override {return "And";}
+        int eval(EvalContext &ctxt) override;
         string infer_type(Semantics *s, Whereami whereami) override;
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             int lhs = left_.init_check(init);
             int rhs = right_.init_check(init);
             if (lhs&&rhs){return 1;}
@@ -604,6 +755,7 @@ namespace AST {
             }
         }
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
         void gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) override;
         explicit And(ASTNode& left, ASTNode& right) :
             BinOp("And", left, right) {}
@@ -613,8 +765,9 @@ namespace AST {
     class Or : public BinOp {
     public:
         std::string get_type() override {return "Or";}
+        int eval(EvalContext &ctxt) override;
         string infer_type(Semantics *s, Whereami whereami) override;
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             int lhs = left_.init_check(init);
             int rhs = right_.init_check(init);
             if (lhs&&rhs){return 1;}
@@ -624,6 +777,7 @@ namespace AST {
             }
         }
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
         void gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) override;
         explicit Or(ASTNode& left, ASTNode& right) :
                 BinOp("Or", left, right) {}
@@ -632,9 +786,11 @@ namespace AST {
     class Not : public Expr {
     public:
         std::string get_type() override {return "Not";}
+        int eval(EvalContext &ctxt) override;
+        int size() override { return folded_ ? 1 : 1 + left_.size(); }
         string infer_type(Semantics *s, Whereami whereami) override;
         ASTNode& left_;
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             if (left_.init_check(init)){return 1;}
             else {
                 cerr<<"Instantiaton error: Variables in 'and' not defined."<<endl;
@@ -642,6 +798,7 @@ namespace AST {
             }
         }
         string gen_rval(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
+        string gen_unboxed(CodegenContext& ctxt, Semantics *s, Whereami whereami) override;
         void gen_branch(CodegenContext &ctxt, string true_branch, string false_branch, Semantics *s, Whereami whereami) override;
         explicit Not(ASTNode& left ):
             left_{left}  {}
@@ -666,24 +823,24 @@ namespace AST {
             std::string rhs = right_.get_name();
             return lhs+"."+rhs;
         }
-        int init_check(vector<string> *init) override {
+        int init_check(Names *init) override {
             if (left_.get_name()=="this"){
-               if (std::find(init->begin(), init->end(), "this")==init->end()){
+               if (!init->contains("this")){
                 cerr<<"Can't call 'this' outside of class!"<<endl;
                 return 0; // not in a class: shouldn't call "this"
                 } 
                 string full_name = "this."+right_.get_name();
-                if (std::find(init->begin(), init->end(), full_name)==init->end()){
+                if (!init->contains(full_name)){
                     cerr<<"Instantiation error: "<<left_.get_name()<<"."<<right_.get_name()<<endl;
                     return 0;
                 } else { return 1; }
             }
             int s1 = left_.init_check(init);
             int s2 = 1; int s3 = 1;
-            if (find(init->begin(),init->end(),right_.text_)==init->end()){
+            if (!init->contains(right_.sym_)){
                 s2 = 0;
             }
-            if (find(init->begin(),init->end(),"this."+right_.text_)==init->end()){
+            if (!init->contains("this."+right_.text_)){
                 s3 = 0;
             }
             if(!s1 || !(s2||s3)){
@@ -709,6 +866,7 @@ namespace AST {
         virtual string get_type() override {return "Program";}
         string infer_type(Semantics *s, Whereami whereami) override;
         virtual string gen_rval(CodegenContext &ctxt, Semantics *s, Whereami whereami) override;
+        int eval(EvalContext &ctxt) override;
         explicit Program(Classes& classes, Block& statements) :
                 classes_{classes}, statements_{statements} {}
         void json(std::ostream& out, AST_print_context& ctx) override;
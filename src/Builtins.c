@@ -6,10 +6,359 @@
 #include <stdio.h>   
 #include <stdlib.h>  /* Malloc lives here; might replace with gc.h    */ 
 #include <string.h>  /* For strcpy; might replace with cords.h from gc */ 
+#include <unistd.h>  /* For write */
+#include <errno.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "Builtins.h"
 
 
+/* ==============
+ * Memory allocation
+ *
+ * Objects are carved from large chunks with a bump pointer. 
+ * Freed objects go on a free list for their size (objects are 
+ * small, fixed-size structs, so there are few distinct sizes) 
+ * and are reused before bumping.  Compile with -DQUACK_MALLOC 
+ * to use plain malloc instead. 
+ * ==============
+ */
+
+#define QUACK_ALIGN 8           /* Alignment and size-class granularity */
+#define QUACK_MAX_SMALL 512     /* Larger requests go straight to malloc */
+#ifndef QUACK_CHUNK_SIZE
+#define QUACK_CHUNK_SIZE (1 << 20)
+#endif
+
+#ifndef QUACK_MALLOC
+struct free_cell { struct free_cell *next; };
+static struct free_cell *free_lists[QUACK_MAX_SMALL / QUACK_ALIGN + 1];
+static char *bump_next = NULL;   /* Next free byte of the current chunk */
+static char *bump_limit = NULL;  /* End of the current chunk */
+#endif
+
+void *quack_alloc(size_t size) {
+#ifdef QUACK_MALLOC
+  return malloc(size);
+#else
+  size_t cls = (size + QUACK_ALIGN - 1) / QUACK_ALIGN;
+  if (cls > QUACK_MAX_SMALL / QUACK_ALIGN) {
+    return malloc(size);
+  }
+  if (free_lists[cls] != NULL) {
+    struct free_cell *cell = free_lists[cls];
+    free_lists[cls] = cell->next;
+    return cell;
+  }
+  size = cls * QUACK_ALIGN;
+  if (bump_next == NULL || bump_limit - bump_next < (long) size) {
+    /* The tail of the old chunk is abandoned */
+    bump_next = (char *) malloc(QUACK_CHUNK_SIZE);
+    if (bump_next == NULL) {
+      fprintf(stderr, "Quack runtime: out of memory\n");
+      exit(1);
+    }
+    bump_limit = bump_next + QUACK_CHUNK_SIZE;
+    COUNT_ALLOC(chunks);
+  }
+  void *obj = bump_next;
+  bump_next += size;
+  return obj;
+#endif
+}
+
+/* Return an object of the given size to its free list */
+void quack_free(void *obj, size_t size) {
+#ifdef QUACK_MALLOC
+  free(obj);
+#else
+  size_t cls = (size + QUACK_ALIGN - 1) / QUACK_ALIGN;
+  if (cls > QUACK_MAX_SMALL / QUACK_ALIGN) {
+    free(obj);
+    return;
+  }
+  struct free_cell *cell = (struct free_cell *) obj;
+  cell->next = free_lists[cls];
+  free_lists[cls] = cell;
+#endif
+}
+
+/* ==============
+ * Garbage collection
+ *
+ * A stop-the-world mark-and-sweep collector.  Marking starts 
+ * from the locals registered on the shadow stack and follows 
+ * reference fields using each object's gc_type; sweeping walks 
+ * the list of all heap objects and returns unmarked ones to 
+ * their free lists.  A collection runs when the bytes allocated 
+ * since the last one exceed the larger of QUACK_GC_THRESHOLD 
+ * and the heap that survived it. 
+ * ==============
+ */
+
+#ifndef QUACK_GC_THRESHOLD
+#define QUACK_GC_THRESHOLD (8 << 20)
+#endif
+
+struct gc_frame *gc_top = NULL;
+static struct gc_header *gc_objects = NULL;   /* All heap objects */
+static size_t gc_allocated = 0;    /* Bytes allocated since last collection */
+static size_t gc_live = 0;         /* Bytes in the heap */
+static size_t gc_limit = QUACK_GC_THRESHOLD;
+static struct gc_header **gc_mark_stack = NULL;
+static size_t gc_mark_depth = 0;
+static size_t gc_mark_capacity = 0;
+
+#ifdef QUACK_GC_STATS
+#include <time.h>
+static struct {
+  long collections;
+  double total_pause;  /* Seconds */
+  double max_pause;
+  size_t peak_heap;    /* Bytes */
+} gc_stats;
+
+static double gc_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void report_gc_stats(void) {
+  fprintf(stderr, "GC: %ld collections, %.3f ms total pause, %.3f ms max pause\n",
+          gc_stats.collections, gc_stats.total_pause * 1e3,
+          gc_stats.max_pause * 1e3);
+  fprintf(stderr, "GC: %zu bytes live at exit, %zu bytes peak heap\n",
+          gc_live, gc_stats.peak_heap);
+}
+#endif
+
+/* Push an object to be traced if it is a heap object not yet marked */
+static void gc_mark_object(struct gc_header *obj) {
+  if (obj == NULL || obj->type == NULL || obj->marked) {
+    return;
+  }
+  obj->marked = 1;
+  if (obj->type->nfields == 0) {
+    return;
+  }
+  if (gc_mark_depth == gc_mark_capacity) {
+    gc_mark_capacity = gc_mark_capacity ? 2 * gc_mark_capacity : 1024;
+    gc_mark_stack = realloc(gc_mark_stack,
+                            gc_mark_capacity * sizeof(struct gc_header *));
+    if (gc_mark_stack == NULL) {
+      fprintf(stderr, "Quack runtime: out of memory\n");
+      exit(1);
+    }
+  }
+  gc_mark_stack[gc_mark_depth++] = obj;
+}
+
+void gc_collect(void) {
+#ifdef QUACK_GC_STATS
+  double start = gc_now();
+#endif
+  struct gc_frame *frame;
+  int i;
+  for (frame = gc_top; frame != NULL; frame = frame->prev) {
+    for (i = 0; i < frame->n; i++) {
+      gc_mark_object((struct gc_header *) *frame->slots[i]);
+    }
+  }
+  while (gc_mark_depth > 0) {
+    struct gc_header *obj = gc_mark_stack[--gc_mark_depth];
+    const struct gc_type *t = obj->type;
+    for (i = 0; i < t->nfields; i++) {
+      gc_mark_object(*(struct gc_header **) ((char *) obj + t->offsets[i]));
+    }
+  }
+  struct gc_header **link = &gc_objects;
+  while (*link != NULL) {
+    struct gc_header *obj = *link;
+    if (obj->marked) {
+      obj->marked = 0;
+      link = &obj->next;
+    } else {
+      *link = obj->next;
+      gc_live -= obj->type->size;
+      if (obj->type->finalize != NULL) {
+        obj->type->finalize(obj);
+      }
+      quack_free(obj, obj->type->size);
+    }
+  }
+  gc_allocated = 0;
+  gc_limit = gc_live > QUACK_GC_THRESHOLD ? gc_live : QUACK_GC_THRESHOLD;
+#ifdef QUACK_GC_STATS
+  double pause = gc_now() - start;
+  gc_stats.collections++;
+  gc_stats.total_pause += pause;
+  if (pause > gc_stats.max_pause) {
+    gc_stats.max_pause = pause;
+  }
+#endif
+}
+
+void *gc_alloc(const struct gc_type *t) {
+#ifndef QUACK_NO_GC
+  if (gc_allocated >= gc_limit) {
+    gc_collect();
+  }
+#endif
+  struct gc_header *obj = (struct gc_header *) quack_alloc(t->size);
+  memset(obj, 0, t->size);
+  obj->type = t;
+  obj->next = gc_objects;
+  gc_objects = obj;
+  gc_allocated += t->size;
+  gc_live += t->size;
+#ifdef QUACK_GC_STATS
+  if (gc_live > gc_stats.peak_heap) {
+    gc_stats.peak_heap = gc_live;
+  }
+#endif
+  return obj;
+}
+
+/* Layouts of the built-in classes.  Only String has reference 
+ * fields, the children of an unflattened rope. 
+ */
+static void gc_finalize_String(void *obj);
+
+const size_t gc_fields_String[] = {
+  offsetof(struct obj_String_struct, left),
+  offsetof(struct obj_String_struct, right)
+};
+
+const struct gc_type gc_type_Obj =
+  { sizeof(struct obj_Obj_struct), 0, NULL, NULL };
+const struct gc_type gc_type_String =
+  { sizeof(struct obj_String_struct), 2, gc_fields_String, gc_finalize_String };
+const struct gc_type gc_type_Boolean =
+  { sizeof(struct obj_Boolean_struct), 0, NULL, NULL };
+const struct gc_type gc_type_Int =
+  { sizeof(struct obj_Int_struct), 0, NULL, NULL };
+
+
+/* ==============
+ * Output
+ *
+ * PRINT appends to one large buffer that goes out in big 
+ * write(2) calls: when it fills, at exit, and after every 
+ * PRINT when standard output is a terminal. 
+ * ==============
+ */
+
+#ifndef QUACK_OUT_BUF_SIZE
+#define QUACK_OUT_BUF_SIZE (64 * 1024)
+#endif
+
+static char out_buf[QUACK_OUT_BUF_SIZE];
+static size_t out_len = 0;
+static int out_interactive = 0;
+
+static void out_write(const char *p, size_t n) {
+  while (n > 0) {
+    ssize_t done = write(1, p, n);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;  /* Nowhere to report it; drop the output */
+    }
+    p += done;
+    n -= done;
+  }
+}
+
+void quack_flush(void) {
+  out_write(out_buf, out_len);
+  out_len = 0;
+}
+
+static void out_bytes(const char *p, size_t n) {
+  if (out_len + n > QUACK_OUT_BUF_SIZE) {
+    quack_flush();
+    if (n > QUACK_OUT_BUF_SIZE) {
+      out_write(p, n);
+      return;
+    }
+  }
+  memcpy(out_buf + out_len, p, n);
+  out_len += n;
+}
+
+/* Finish a line of PRINT output */
+static void out_newline(void) {
+  if (out_len == QUACK_OUT_BUF_SIZE) {
+    quack_flush();
+  }
+  out_buf[out_len++] = '\n';
+  if (out_interactive) {
+    quack_flush();
+  }
+}
+
+static void out_string(obj_String s) {
+  out_bytes(str_flatten(s), s->length);
+}
+
+/* Decimal formatting of Ints, two digits per step from a 
+ * table of digit pairs.  format_int writes the digits so 
+ * that they end just before end, and returns where they start. 
+ */
+#define INT_DIGITS_MAX 11  /* "-2147483648" */
+
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static char *format_int(int n, char *end) {
+  unsigned int u = n < 0 ? 0u - (unsigned int) n : (unsigned int) n;
+  char *p = end;
+  while (u >= 100) {
+    unsigned int pair = (u % 100) * 2;
+    u /= 100;
+    *--p = digit_pairs[pair + 1];
+    *--p = digit_pairs[pair];
+  }
+  if (u >= 10) {
+    *--p = digit_pairs[u * 2 + 1];
+    *--p = digit_pairs[u * 2];
+  } else {
+    *--p = (char) ('0' + u);
+  }
+  if (n < 0) {
+    *--p = '-';
+  }
+  return p;
+}
+
+static void out_int(int n) {
+  if (out_len + INT_DIGITS_MAX > QUACK_OUT_BUF_SIZE) {
+    quack_flush();
+  }
+  /* Format at the far end of the free space, then slide down */
+  char *end = out_buf + out_len + INT_DIGITS_MAX;
+  char *start = format_int(n, end);
+  size_t len = end - start;
+  memmove(out_buf + out_len, start, len);
+  out_len += len;
+}
+
 /* ==============
  * Obj 
  * Fields: None
@@ -22,11 +371,10 @@
  * ==============
  */
 
-class_Obj the_class_Obj;
-
 /* Constructor */
 obj_Obj new_Obj(  ) {
-  obj_Obj new_thing = (obj_Obj) malloc(sizeof(struct obj_Obj_struct));
+  obj_Obj new_thing = (obj_Obj) gc_alloc(&gc_type_Obj);
+  COUNT_ALLOC(objs);
   new_thing->clazz = the_class_Obj;
   return new_thing; 
 }
@@ -37,6 +385,7 @@ obj_String Obj_method_STR(obj_Obj this) {
   char *rep;
   asprintf(&rep, "<Object at %ld>", addr);
   obj_String str = str_literal(rep); 
+  free(rep);
   return str;
 }
 
@@ -45,8 +394,13 @@ obj_String Obj_method_STR(obj_Obj this) {
 /* Obj:PRINT */
 obj_Nothing Obj_method_PRINT(obj_Obj this) {
   //fprintf(stdout, "IN OBJ PRINT \n", "");
-  obj_String str = this->clazz->STR(this);
-  fprintf(stdout, "%s\n", str->text);
+  /* Booleans inherit PRINT but have constant strings to print */
+  if (this->clazz == (class_Obj) the_class_Boolean) {
+    out_string(Boolean_method_STR((obj_Boolean) this));  /* A constant */
+  } else {
+    out_string(this->clazz->STR(this));
+  }
+  out_newline();
   return nothing;
   //return this;
 }
@@ -62,14 +416,15 @@ obj_Boolean Obj_method_EQUALS(obj_Obj this, obj_Obj other) {
   
 
 /* The Obj Class (a singleton) */
-struct  class_Obj_struct  the_class_Obj_struct = {
+const struct class_Obj_struct the_class_Obj_struct = {
+  QUACK_CLASS_ID_Obj, QUACK_LAST_CLASS_ID,
   new_Obj,     /* Constructor */
   Obj_method_STR, 
   Obj_method_PRINT, 
   Obj_method_EQUALS
 };
 
-class_Obj the_class_Obj = &the_class_Obj_struct; 
+const class_Obj the_class_Obj = &the_class_Obj_struct; 
 
  
 /* ================
@@ -85,7 +440,8 @@ class_Obj the_class_Obj = &the_class_Obj_struct;
 
 /* Constructor */
 obj_String new_String(  ) {
-  obj_String new_thing = (obj_String) malloc(sizeof(struct obj_String_struct));
+  obj_String new_thing = (obj_String) gc_alloc(&gc_type_String);
+  COUNT_ALLOC(strings);
   new_thing->clazz = the_class_String;
   //new_thing->text = "";
   return new_thing; 
@@ -99,46 +455,214 @@ obj_String String_method_STR(obj_String this) {
 /* String:PRINT */
 obj_Nothing String_method_PRINT(obj_String this) {
   //fprintf(stdout, "IN STRING PRINT%s\n", "");
-  fprintf(stdout, "%s\n", this->text);
+  out_string(this);
+  out_newline();
   return nothing;
 }
   
-/* String:EQUALS (Note we may want to replace this */
+/* Compare n bytes like memcmp, a vector at a time where the 
+ * target has SSE2 or AVX2: the first differing byte is found 
+ * from the mask of equal lanes. 
+ */
+static int bytes_compare(const unsigned char *a, const unsigned char *b, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256((const __m256i *) (a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *) (b + i));
+    unsigned int ne = ~(unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+    if (ne != 0) {
+      size_t at = i + __builtin_ctz(ne);
+      return (int) a[at] - (int) b[at];
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+    unsigned int ne = 0xffff & ~(unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+    if (ne != 0) {
+      size_t at = i + __builtin_ctz(ne);
+      return (int) a[at] - (int) b[at];
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (a[i] != b[i]) {
+      return (int) a[i] - (int) b[i];
+    }
+  }
+  return 0;
+}
+
+/* 32-bit FNV-1a, continued over successive pieces of a String */
+#define FNV_BASIS 2166136261u
+static unsigned int fnv_extend(unsigned int h, const char *p, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    h = (h ^ (unsigned char) p[i]) * 16777619u;
+  }
+  return h;
+}
+
+/* Hash values are never 0, which marks a hash not yet computed */
+static unsigned int fnv_final(unsigned int h) {
+  return h == 0 ? 1 : h;
+}
+
+unsigned int str_hash(obj_String s) {
+  if (s->hash == 0) {
+    char *text = str_flatten(s);  /* Sets the hash of a rope */
+    if (s->hash == 0) {
+      s->hash = fnv_final(fnv_extend(FNV_BASIS, text, s->length));
+    }
+  }
+  return s->hash;
+}
+
+int str_equal(obj_String a, obj_String b) {
+  if (a == b) {
+    return 1;
+  }
+  if (a->length != b->length || str_hash(a) != str_hash(b)) {
+    return 0;
+  }
+  return bytes_compare((unsigned char *) a->text, (unsigned char *) b->text,
+                       a->length) == 0;
+}
+
+int str_compare(obj_String a, obj_String b) {
+  size_t n = a->length < b->length ? a->length : b->length;
+  int c = bytes_compare((unsigned char *) str_flatten(a),
+                        (unsigned char *) str_flatten(b), n);
+  if (c != 0) {
+    return c;
+  }
+  return (a->length > b->length) - (a->length < b->length);
+}
+
+/* String:EQUALS */
 obj_Boolean String_method_EQUALS(obj_String this, obj_Obj other) {
   obj_String other_str = (obj_String) other;
   /* But is it really? */
   if (other_str->clazz != the_class_String) {
     return lit_false;
   }
-  if (strcmp(this->text,other_str->text) == 0) {
+  if (str_equal(this, other_str)) {
     return lit_true;
   } else {
     return lit_false;
   }
 }
 
+/* String:LESS */
+obj_Boolean String_method_LESS(obj_String this, obj_String other) {
+  if (str_compare(this, other) < 0) {
+    return lit_true;
+  }
+  return lit_false;
+}
+
+/* String:PLUS 
+ * Concatenation just makes a rope node, so building a String 
+ * piece by piece is linear overall; the bytes are copied once, 
+ * when something needs them contiguous.  Short results are 
+ * copied right away instead, to keep ropes from being mostly 
+ * tiny nodes. 
+ */
+#ifndef QUACK_ROPE_MIN
+#define QUACK_ROPE_MIN 32
+#endif
+
 obj_String String_method_PLUS(obj_String this, obj_String other) {
-  size_t lthis = strlen(this->text);
-  size_t lother = strlen(other->text);
-  char buf[1000]; // not great but it'll do for small programs!!
-  buf[0] = '\0';
-  strcat(buf, this->text);
-  strcat(buf, other->text);
-  char *newtext = strdup(buf);
-  return str_literal(newtext);
+  if (this->length == 0) {
+    return other;
+  }
+  if (other->length == 0) {
+    return this;
+  }
+  obj_String str = the_class_String->constructor();
+  str->length = this->length + other->length;
+  if (str->length < QUACK_ROPE_MIN) {
+    char *newtext = malloc(str->length + 1);
+    memcpy(newtext, str_flatten(this), this->length);
+    memcpy(newtext + this->length, str_flatten(other), other->length + 1);
+    str->text = newtext;  /* Owned by the new String */
+    str->hash = fnv_final(fnv_extend(FNV_BASIS, newtext, str->length));
+  } else {
+    str->left = this;
+    str->right = other;
+  }
+  return str;
+}
+
+/* Copy the leaves of a rope into one buffer, left to right, 
+ * with an explicit stack since ropes built in a loop are as 
+ * deep as they are long.  The node then holds the text itself 
+ * and lets go of its children. 
+ */
+static obj_String *flatten_stack = NULL;
+static size_t flatten_capacity = 0;
+
+char *str_flatten(obj_String s) {
+  if (s->text != NULL) {
+    return s->text;
+  }
+  char *buf = malloc(s->length + 1);
+  unsigned int h = FNV_BASIS;
+  size_t pos = 0;
+  size_t depth = 0;
+  obj_String node = s;
+  for (;;) {
+    if (node->text != NULL) {
+      memcpy(buf + pos, node->text, node->length);
+      h = fnv_extend(h, node->text, node->length);
+      pos += node->length;
+      if (depth == 0) {
+        break;
+      }
+      node = flatten_stack[--depth];
+    } else {
+      if (depth == flatten_capacity) {
+        flatten_capacity = flatten_capacity ? 2 * flatten_capacity : 256;
+        flatten_stack = realloc(flatten_stack,
+                                flatten_capacity * sizeof(obj_String));
+        if (flatten_stack == NULL) {
+          fprintf(stderr, "Quack runtime: out of memory\n");
+          exit(1);
+        }
+      }
+      flatten_stack[depth++] = node->right;
+      node = node->left;
+    }
+  }
+  buf[pos] = '\0';
+  s->text = buf;
+  s->hash = fnv_final(h);
+  s->left = NULL;
+  s->right = NULL;
+  return buf;
 }
 
 
 /* The String Class (a singleton) */
-struct  class_String_struct  the_class_String_struct = {
+const struct class_String_struct the_class_String_struct = {
+  QUACK_CLASS_ID_String, QUACK_CLASS_ID_String,
   new_String,     /* Constructor */
   String_method_STR, 
-  String_method_PLUS,
   String_method_PRINT, 
-  String_method_EQUALS
+  String_method_EQUALS,
+  String_method_PLUS,
+  String_method_LESS
 };
 
-class_String the_class_String = &the_class_String_struct; 
+const class_String the_class_String = &the_class_String_struct; 
+
+/* A heap String owns its text, which is freed with it */
+static void gc_finalize_String(void *obj) {
+  free(((obj_String) obj)->text);
+}
 
 /* 
  * Internal use function for creating String objects
@@ -150,6 +674,8 @@ obj_String str_literal(char *s) {
   //printf("In str lit.\n");
   //fprintf(stdout, "s: %s\n", s);
   str->text = strdup(s);
+  str->length = strlen(s);
+  str->hash = fnv_final(fnv_extend(FNV_BASIS, s, str->length));
   return str;
 }
 
@@ -163,20 +689,30 @@ obj_String str_literal(char *s) {
  */
 /* Constructor */
 obj_Boolean new_Boolean(  ) {
-  obj_Boolean new_thing = (obj_Boolean)
-    malloc(sizeof(struct obj_Boolean_struct));
+  obj_Boolean new_thing = (obj_Boolean) gc_alloc(&gc_type_Boolean);
+  COUNT_ALLOC(booleans);
   new_thing->clazz = the_class_Boolean;
   return new_thing; 
 }
 
-/* Boolean:STR */
+/* Boolean:STR 
+ * The strings are constants, like the literal pool the 
+ * compiler emits, so printing a Boolean allocates nothing. 
+ */
+struct obj_String_struct str_true_struct =
+  { GC_STATIC, &the_class_String_struct, "true", 4 };
+struct obj_String_struct str_false_struct =
+  { GC_STATIC, &the_class_String_struct, "false", 5 };
+struct obj_String_struct str_bogus_struct =
+  { GC_STATIC, &the_class_String_struct, "!!!BOGUS BOOLEAN", 16 };
+
 obj_String Boolean_method_STR(obj_Boolean this) {
   if (this == lit_true) {
-    return str_literal("true");
+    return &str_true_struct;
   } else if (this == lit_false) {
-    return str_literal("false");
+    return &str_false_struct;
   } else {
-    return str_literal("!!!BOGUS BOOLEAN");
+    return &str_bogus_struct;
   }
 }
 
@@ -187,14 +723,15 @@ obj_String Boolean_method_STR(obj_Boolean this) {
 /* Inherit Obj:PRINT, which will call Boolean:STRING */
 
 /* The Boolean Class (a singleton) */
-struct  class_Boolean_struct  the_class_Boolean_struct = {
+const struct class_Boolean_struct the_class_Boolean_struct = {
+  QUACK_CLASS_ID_Boolean, QUACK_CLASS_ID_Boolean,
   new_Boolean,     /* Constructor */
   Boolean_method_STR, 
   Obj_method_PRINT, 
   Obj_method_EQUALS
 };
 
-class_Boolean the_class_Boolean = &the_class_Boolean_struct; 
+const class_Boolean the_class_Boolean = &the_class_Boolean_struct; 
   
 /* 
  * These are the only two objects of type Boolean that 
@@ -202,10 +739,10 @@ class_Boolean the_class_Boolean = &the_class_Boolean_struct;
  * them. 
  */ 
 struct obj_Boolean_struct lit_false_struct =
-  { &the_class_Boolean_struct, 0 };
+  { GC_STATIC, &the_class_Boolean_struct, 0 };
 obj_Boolean lit_false = &lit_false_struct;
 struct obj_Boolean_struct lit_true_struct =
-  { &the_class_Boolean_struct, 1 };
+  { GC_STATIC, &the_class_Boolean_struct, 1 };
 obj_Boolean lit_true = &lit_true_struct;
 
 /* ==============
@@ -224,9 +761,12 @@ obj_Nothing new_Nothing(  ) {
   return nothing; 
 }
 
-/* Boolean:STR */
+/* Nothing:STR */
+struct obj_String_struct str_nothing_struct =
+  { GC_STATIC, &the_class_String_struct, "<nothing>", 9 };
+
 obj_String Nothing_method_STR(obj_Nothing this) {
-    return str_literal("<nothing>");
+    return &str_nothing_struct;
 }
 
 /* Inherit Obj:EQUAL, since we have only one
@@ -236,21 +776,22 @@ obj_String Nothing_method_STR(obj_Nothing this) {
 /* Inherit Obj:PRINT, which will call Nothing:STR */
 
 /* The Nothing Class (a singleton) */
-struct  class_Nothing_struct  the_class_Nothing_struct = {
+const struct class_Nothing_struct the_class_Nothing_struct = {
+  QUACK_CLASS_ID_Nothing, QUACK_CLASS_ID_Nothing,
   new_Nothing,     /* Constructor */
   Nothing_method_STR, 
   Obj_method_PRINT, 
   Obj_method_EQUALS
 };
 
-class_Nothing the_class_Nothing = &the_class_Nothing_struct; 
+const class_Nothing the_class_Nothing = &the_class_Nothing_struct; 
   
 /* 
  * This is the only instance of class Nothing that 
  * should ever exist
  */ 
 struct obj_Nothing_struct nothing_struct =
-  { &the_class_Nothing_struct };
+  { GC_STATIC, &the_class_Nothing_struct };
 obj_Nothing nothing = &nothing_struct; 
 
 /* ================
@@ -267,8 +808,8 @@ obj_Nothing nothing = &nothing_struct;
 
 /* Constructor */
 obj_Int new_Int(  ) {
-  obj_Int new_thing = (obj_Int)
-    malloc(sizeof(struct obj_Int_struct));
+  obj_Int new_thing = (obj_Int) gc_alloc(&gc_type_Int);
+  COUNT_ALLOC(ints);
   new_thing->clazz = the_class_Int;
   new_thing->value = 0;          
   return new_thing; 
@@ -276,9 +817,23 @@ obj_Int new_Int(  ) {
 
 /* Int:STR */
 obj_String Int_method_STR(obj_Int this) {
-  char *rep;
-  asprintf(&rep, "%d", this->value);
-  return str_literal(rep); 
+  char digits[INT_DIGITS_MAX];
+  char *end = digits + INT_DIGITS_MAX;
+  char *start = format_int(this->value, end);
+  obj_String str = the_class_String->constructor();
+  str->length = end - start;
+  str->text = malloc(str->length + 1);
+  memcpy(str->text, start, str->length);
+  str->text[str->length] = '\0';
+  str->hash = fnv_final(fnv_extend(FNV_BASIS, str->text, str->length));
+  return str;
+}
+
+/* Int:PRINT (override) writes the digits straight to the output */
+obj_Nothing Int_method_PRINT(obj_Int this) {
+  out_int(this->value);
+  out_newline();
+  return nothing;
 }
 
 /* Int:EQUALS */
@@ -294,7 +849,6 @@ obj_Boolean Int_method_EQUALS(obj_Int this, obj_Obj other) {
   return lit_true;
 }
 
-/* Inherit Obj:PRINT, which will call Int:STR */
 
 /* LESS (new method) */ 
 obj_Boolean Int_method_LESS(obj_Int this, obj_Int other) {
@@ -344,30 +898,122 @@ obj_Int Int_method_DIVIDE(obj_Int this, obj_Int other) {
 }
 
 /* The Int Class (a singleton) */
-struct  class_Int_struct  the_class_Int_struct = {
+const struct class_Int_struct the_class_Int_struct = {
+  QUACK_CLASS_ID_Int, QUACK_CLASS_ID_Int,
   new_Int,     /* Constructor */
   Int_method_STR, 
-  Obj_method_PRINT, 
+  Int_method_PRINT, 
   Int_method_EQUALS,
   Int_method_LESS,
   Int_method_GREATER,
-  Int_method_ATLEAST,
   Int_method_ATMOST,
+  Int_method_ATLEAST,
   Int_method_PLUS,
   Int_method_MINUS,
   Int_method_TIMES,
   Int_method_DIVIDE
 };
 
-class_Int the_class_Int = &the_class_Int_struct; 
+const class_Int the_class_Int = &the_class_Int_struct; 
+
+/* Shared boxes for small Ints, filled in by quack_init and 
+ * never modified afterward. 
+ */
+struct obj_Int_struct small_ints[QUACK_SMALL_INT_MAX - QUACK_SMALL_INT_MIN + 1];
   
 /* Integer literals constructor, 
  * used by compiler and not otherwise available in 
  * Quack programs. 
  */
 obj_Int int_literal(int n) {
+  if (n >= QUACK_SMALL_INT_MIN && n <= QUACK_SMALL_INT_MAX) {
+    COUNT_ALLOC(int_cache_hits);
+    return &small_ints[n - QUACK_SMALL_INT_MIN];
+  }
   obj_Int boxed = new_Int();
   boxed->value = n;
   return boxed;
 }
 
+/* ================
+ * Runtime support
+ * ================
+ */
+
+struct quack_alloc_stats quack_stats;
+
+#ifdef QUACK_ALLOC_STATS
+static void report_alloc_stats(void) {
+  fprintf(stderr, "Allocations: %ld Obj, %ld String, %ld Boolean, %ld Int\n",
+          quack_stats.objs, quack_stats.strings, quack_stats.booleans,
+          quack_stats.ints);
+  fprintf(stderr, "Small Int cache hits: %ld\n", quack_stats.int_cache_hits);
+  fprintf(stderr, "Arena chunks: %ld\n", quack_stats.chunks);
+}
+#endif
+
+static struct quack_ic_site *ic_sites = NULL;
+
+void quack_ic_count(struct quack_ic_site *site, int hit) {
+  if (site->hits + site->misses == 0) {
+    site->next = ic_sites;
+    ic_sites = site;
+  }
+  if (hit) {
+    site->hits++;
+  } else {
+    site->misses++;
+  }
+}
+
+#ifdef QUACK_IC_STATS
+static void report_ic_stats(void) {
+  struct quack_ic_site *site;
+  for (site = ic_sites; site != NULL; site = site->next) {
+    fprintf(stderr, "Inline cache %s: %ld hits, %ld misses\n",
+            site->where, site->hits, site->misses);
+  }
+}
+#endif
+
+struct quack_tail_call quack_tail;
+
+obj_Obj quack_run_tail(void) {
+  typedef obj_Obj o;
+  obj_Obj *a = quack_tail.args;
+  obj_Obj result;
+  do {
+    void (*fn)(void) = quack_tail.fn;
+    switch (quack_tail.nargs) {
+    case 1: result = ((o (*)(o)) fn)(a[0]); break;
+    case 2: result = ((o (*)(o, o)) fn)(a[0], a[1]); break;
+    case 3: result = ((o (*)(o, o, o)) fn)(a[0], a[1], a[2]); break;
+    case 4: result = ((o (*)(o, o, o, o)) fn)(a[0], a[1], a[2], a[3]); break;
+    case 5: result = ((o (*)(o, o, o, o, o)) fn)(a[0], a[1], a[2], a[3], a[4]); break;
+    case 6: result = ((o (*)(o, o, o, o, o, o)) fn)(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case 7: result = ((o (*)(o, o, o, o, o, o, o)) fn)(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+    default: result = ((o (*)(o, o, o, o, o, o, o, o)) fn)(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]); break;
+    }
+  } while (result == QUACK_TAIL_PENDING);
+  return result;
+}
+
+void quack_init(void) {
+  int i;
+  for (i = 0; i <= QUACK_SMALL_INT_MAX - QUACK_SMALL_INT_MIN; i++) {
+    small_ints[i].clazz = the_class_Int;
+    small_ints[i].value = QUACK_SMALL_INT_MIN + i;
+  }
+#ifdef QUACK_ALLOC_STATS
+  atexit(report_alloc_stats);
+#endif
+#ifdef QUACK_GC_STATS
+  atexit(report_gc_stats);
+#endif
+#ifdef QUACK_IC_STATS
+  atexit(report_ic_stats);
+#endif
+  out_interactive = isatty(1);
+  atexit(quack_flush);  /* Registered last so it runs first */
+}
+
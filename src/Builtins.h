@@ -1,14 +1,13 @@
 /*
  * The Quack runtime needs a base class Obj and a handful 
  * of built-in classes  (Int, String, Nothing, Boolean)
- *
- * 2018 note (FIXME): The class structure needs a field that 
- * points to the supertype.  
  */
 
 #ifndef Builtins_h
 #define Builtins_h
 
+#include <stddef.h>
+
 /* Naming conventions:  
  * class_X means a reference to the class structure for class X, 
  * i.e., pointer to the struct that contains the method table. 
@@ -21,6 +20,8 @@
  * e.g., class_Obj will be typedefed to struct class_Obj_struct *. 
  * Each class will have a single instantiation as the_class_X. 
  * the_class_X is a pointer to a statically allocated structure. 
+ * Class structures are const, so the C compiler can resolve 
+ * method calls through the_class_X at compile time. 
  * 
  * All programmer-visible fields of objects are references to 
  * other objects. Boolean, Int, and String have "hidden" fields 
@@ -30,8 +31,100 @@
  * structs containing function pointers with particular signatures. 
  * The receiver object ('this' in Quack) is an implicit argument 
  * in Quack but an explicit argument in the runtime. 
+ * 
+ * Ahead of the method table, every class structure holds the 
+ * class's number in a preorder walk of the class hierarchy, and 
+ * the greatest number among its subclasses, so that an object is 
+ * an instance of class C exactly when its class id lies in C's 
+ * range.  Obj is 0, then Int, String, Boolean, Nothing (which 
+ * cannot be extended), then the user-defined classes. 
  */ 
 
+#define QUACK_CLASS_ID_Obj 0
+#define QUACK_CLASS_ID_Int 1
+#define QUACK_CLASS_ID_String 2
+#define QUACK_CLASS_ID_Boolean 3
+#define QUACK_CLASS_ID_Nothing 4
+
+/* Greatest class id in the program, defined by the generated 
+ * code before it includes Builtins.c 
+ */
+#ifndef QUACK_LAST_CLASS_ID
+#define QUACK_LAST_CLASS_ID QUACK_CLASS_ID_Nothing
+#endif
+
+/* ==============
+ * Garbage collection 
+ * 
+ * Every object struct begins with a gc_header.  Heap objects 
+ * are linked on a list of all objects and point to a gc_type 
+ * that gives their size and the offsets of their reference 
+ * fields, so the collector is precise.  Statically allocated 
+ * objects (literals, the Booleans, nothing) have a NULL type 
+ * and are never collected or traced. 
+ * 
+ * Roots are the locals of active Quack methods, which each 
+ * generated function registers in a gc_frame on a shadow stack. 
+ * ==============
+ */
+
+struct gc_type {
+  size_t size;                  /* Bytes to allocate */
+  int nfields;                  /* Number of object references ... */
+  const size_t *offsets;        /* ... at these offsets */
+  void (*finalize)(void *);     /* Releases non-object storage, or NULL */
+};
+
+struct gc_header {
+  struct gc_header *next;       /* All heap objects, for sweeping */
+  const struct gc_type *type;   /* NULL for static objects */
+  int marked;
+};
+
+/* Initializer for the header of a statically allocated object */
+#define GC_STATIC { 0, 0, 0 }
+
+struct gc_frame {
+  struct gc_frame *prev;
+  int n;
+  void ***slots;                /* Addresses of the frame's object locals */
+};
+extern struct gc_frame *gc_top;
+
+/* Allocate a zeroed object of type t, collecting first if the 
+ * heap has grown enough since the last collection. 
+ */
+extern void *gc_alloc(const struct gc_type *t);
+extern void gc_collect(void);
+
+/* Compile the generated program with -DQUACK_NO_GC to allocate 
+ * without ever collecting, or -DQUACK_GC_STATS to report 
+ * collections, pause times and heap sizes on stderr at exit. 
+ */
+#ifdef QUACK_NO_GC
+#define GC_PUSH_FRAME(s, count) ((void) 0)
+#define GC_POP_FRAME() ((void) 0)
+#else
+#define GC_PUSH_FRAME(s, count) \
+  struct gc_frame gc_frame = { gc_top, (count), (s) }; gc_top = &gc_frame
+#define GC_POP_FRAME() (gc_top = gc_frame.prev)
+#endif
+
+/* A call in tail position, once the caller's frame is popped, reuses 
+ * the caller's stack where the C compiler can be made to guarantee it 
+ * (clang, gcc 15) and the callee takes as many arguments.  Otherwise, 
+ * or with -DQUACK_NO_MUSTTAIL, it goes through the trampoline below: 
+ * an ordinary call would not do, since the published address of the 
+ * GC frame keeps gcc from reusing the stack even at -O2. 
+ */
+#ifndef QUACK_NO_MUSTTAIL
+#if defined(__has_attribute)
+#if __has_attribute(musttail)
+#define QUACK_MUSTTAIL __attribute__((musttail))
+#endif
+#endif
+#endif
+
 /* The following object types are "known" from Obj, in the 
  * sense that there are Obj methods that return these types. 
  */
@@ -57,13 +150,16 @@ typedef struct obj_Nothing_struct* obj_Nothing;
  */
 
 struct class_Obj_struct;
-typedef struct class_Obj_struct* class_Obj; 
+typedef const struct class_Obj_struct* class_Obj; 
 
 typedef struct obj_Obj_struct {
-  struct class_Obj_struct *clazz;
+  struct gc_header gc;
+  class_Obj clazz;
 } * obj_Obj;
 
 struct class_Obj_struct {
+  int id;                  /* Preorder class ids */
+  int last_descendant_id;
   /* Method table */
   obj_Obj (*constructor) ( void );
   obj_String (*STR) (obj_Obj);
@@ -71,13 +167,14 @@ struct class_Obj_struct {
   obj_Boolean (*EQUALS) (obj_Obj, obj_Obj);
 }; 
 
-extern class_Obj the_class_Obj; /* Initialized in Builtins.c */
+extern const class_Obj the_class_Obj; /* Initialized in Builtins.c */
 
 /* ================
  * String
  * Fields: 
- *    One hidden field, currently holding char*
- *    (change later to a rope for garbage collection)
+ *    Hidden fields holding a rope: either flat text, or 
+ *    the concatenation of two Strings, flattened lazily 
+ *    when contiguous bytes are needed. 
  * Methods: 
  *    Those of Obj, plus ordering, concatenation 
  *    (Incomplete for now.)
@@ -85,25 +182,32 @@ extern class_Obj the_class_Obj; /* Initialized in Builtins.c */
  */
 
 struct class_String_struct;
-typedef struct class_String_struct* class_String;
+typedef const struct class_String_struct* class_String;
 
 typedef struct obj_String_struct {
+  struct gc_header gc;
   class_String clazz;
-  char *text;     /* FIXME: Make this a garbage-collectable rope */ 
+  char *text;     /* NUL-terminated bytes, or NULL until flattened */
+  size_t length;
+  unsigned int hash;  /* Of the text, or 0 if not yet computed */
+  struct obj_String_struct *left;   /* A concatenation not yet flattened */
+  struct obj_String_struct *right;  /* is left + right; else both NULL */
 } * obj_String;
 
 struct class_String_struct {
+  int id;                  /* Preorder class ids */
+  int last_descendant_id;
   /* Method table: Inherited or overridden */
   obj_String (*constructor) ( void );
   obj_String (*STR) (obj_String);
-  obj_String (*PLUS) (obj_String, obj_String);
   obj_Nothing (*PRINT) (obj_String);
   obj_Boolean (*EQUALS) (obj_String, obj_Obj);
   /* Method table: Introduced in String */
+  obj_String (*PLUS) (obj_String, obj_String);
   obj_Boolean (*LESS) (obj_String, obj_String); 
 };
 
-extern class_String the_class_String;
+extern const class_String the_class_String;
 
 /* Construct an object from a string literal. 
  * This is not available to the Quack programmer, but 
@@ -112,6 +216,20 @@ extern class_String the_class_String;
  */ 
 extern obj_String str_literal(char *s);
 
+/* The contiguous text of a String, flattening its rope 
+ * first if need be. 
+ */
+extern char *str_flatten(obj_String s);
+
+/* Comparisons used by String EQUALS and LESS, and inlined by 
+ * the compiler.  str_equal rejects on length or hash before 
+ * looking at the bytes; str_compare orders like memcmp, with 
+ * a shorter prefix first. 
+ */
+extern unsigned int str_hash(obj_String s);
+extern int str_equal(obj_String a, obj_String b);
+extern int str_compare(obj_String a, obj_String b);
+
 /* ================
  * Boolean
  * Fields: 
@@ -122,14 +240,17 @@ extern obj_String str_literal(char *s);
  */
 
 struct class_Boolean_struct;
-typedef struct class_Boolean_struct* class_Boolean; 
+typedef const struct class_Boolean_struct* class_Boolean; 
 
 typedef struct obj_Boolean_struct {
+  struct gc_header gc;
   class_Boolean  clazz;
   int value; 
 } * obj_Boolean;
 
 struct class_Boolean_struct {
+  int id;                  /* Preorder class ids */
+  int last_descendant_id;
   /* Method table: Inherited or overridden */
   obj_Boolean (*constructor) ( void );
   obj_String (*STR) (obj_Boolean);
@@ -137,7 +258,7 @@ struct class_Boolean_struct {
   obj_Boolean (*EQUALS) (obj_Obj, obj_Obj); /* Inherit */ 
 };
 
-extern class_Boolean the_class_Boolean; 
+extern const class_Boolean the_class_Boolean; 
 
 /* There are only two instances of Boolean, 
  * lit_true and lit_false
@@ -162,9 +283,10 @@ extern obj_Boolean lit_true;
  */
 
 struct class_Nothing_struct;
-typedef struct class_Nothing_struct* class_Nothing; 
+typedef const struct class_Nothing_struct* class_Nothing; 
 
 typedef struct obj_Nothing_struct {
+  struct gc_header gc;
   class_Nothing clazz;
 } * obj_Nothing;
 
@@ -174,6 +296,8 @@ typedef struct obj_Nothing_struct {
  * "None". 
  */ 
 struct class_Nothing_struct {
+  int id;                  /* Preorder class ids */
+  int last_descendant_id;
   /* Method table */
   obj_Nothing (*constructor) ( void );
   obj_String (*STR) (obj_Nothing);
@@ -181,7 +305,7 @@ struct class_Nothing_struct {
   obj_Boolean (*EQUALS) (obj_Obj, obj_Obj); /* Inherited */
 }; 
 
-extern class_Nothing the_class_Nothing;
+extern const class_Nothing the_class_Nothing;
 
 /* There is a single instance of Nothing, 
  * called nothing
@@ -194,7 +318,7 @@ extern obj_Nothing nothing;
  *    One hidden field, an int
  * Methods: 
  *    STR  (override)
- *    PRINT   (inherit)
+ *    PRINT   (override)
  *    EQUALS  (override)
  *    and introducing
  *    LESS
@@ -204,18 +328,21 @@ extern obj_Nothing nothing;
  */
 
 struct class_Int_struct;
-typedef struct class_Int_struct* class_Int; 
+typedef const struct class_Int_struct* class_Int; 
 
 typedef struct obj_Int_struct {
+  struct gc_header gc;
   class_Int  clazz;
   int value; 
 } * obj_Int;
 
 struct class_Int_struct {
+  int id;                  /* Preorder class ids */
+  int last_descendant_id;
   /* Method table: Inherited or overridden */
   obj_Int (*constructor) ( void );
   obj_String (*STR) (obj_Int);  /* Overridden */
-  obj_Nothing (*PRINT) (obj_Obj);      /* Inherited */
+  obj_Nothing (*PRINT) (obj_Int);      /* Overridden */
   obj_Boolean (*EQUALS) (obj_Int, obj_Obj); /* Overridden */
   obj_Boolean (*LESS) (obj_Int, obj_Int);   /* Introduced */
   obj_Boolean (*GREATER) (obj_Int, obj_Int);   /* Introduced */
@@ -227,7 +354,7 @@ struct class_Int_struct {
   obj_Int (*DIVIDE) (obj_Int, obj_Int);       /* Introduced */
 };
 
-extern class_Int the_class_Int; 
+extern const class_Int the_class_Int; 
 
 /* Integer literals constructor, 
  * used by compiler and not otherwise available in 
@@ -235,6 +362,19 @@ extern class_Int the_class_Int;
  */
 extern obj_Int int_literal(int n);
 
+/* Boxed Ints in [QUACK_SMALL_INT_MIN, QUACK_SMALL_INT_MAX] 
+ * are shared, immutable instances from a table filled in by 
+ * quack_init, so int_literal and the Int arithmetic methods 
+ * do not allocate for them.  Override the range with -D when 
+ * compiling the generated program. 
+ */
+#ifndef QUACK_SMALL_INT_MIN
+#define QUACK_SMALL_INT_MIN (-128)
+#endif
+#ifndef QUACK_SMALL_INT_MAX
+#define QUACK_SMALL_INT_MAX 1023
+#endif
+
 
 /* ===============================
  * Make all the methods we might 
@@ -247,11 +387,100 @@ obj_Boolean Obj_method_EQUALS(obj_Obj this, obj_Obj other);
 obj_String String_method_STR(obj_String this);
 obj_Nothing String_method_PRINT(obj_String this); 
 obj_Boolean String_method_EQUALS(obj_String this, obj_Obj other); 
+obj_Boolean String_method_LESS(obj_String this, obj_String other);
 obj_String Boolean_method_STR(obj_Boolean this); 
 obj_String Nothing_method_STR(obj_Nothing this);
 obj_String Int_method_STR(obj_Int this); 
+obj_Nothing Int_method_PRINT(obj_Int this);
 obj_Boolean Int_method_EQUALS(obj_Int this, obj_Obj other);
 obj_Boolean Int_method_LESS(obj_Int this, obj_Int other);
 obj_Int Int_method_PLUS(obj_Int this, obj_Int other);
 
+/* ===============================
+ * Runtime support
+ *================================
+ */
+
+/* Called by the generated main before any Quack code runs */
+extern void quack_init(void);
+
+/* PRINT output is buffered; this writes out what is pending. 
+ * It runs automatically at exit. 
+ */
+extern void quack_flush(void);
+
+/* Storage for objects, built-in and generated alike.  Uses a 
+ * bump-pointer arena with per-size free lists unless compiled 
+ * with -DQUACK_MALLOC. 
+ */
+extern void *quack_alloc(size_t size);
+extern void quack_free(void *obj, size_t size);
+
+/* Heap allocation counters.  Compile the generated program with 
+ * -DQUACK_ALLOC_STATS to count allocations and have the totals 
+ * reported on stderr at exit; otherwise counting costs nothing. 
+ */
+struct quack_alloc_stats {
+  long objs;            /* Obj and user-defined classes */
+  long strings;
+  long booleans;
+  long ints;
+  long int_cache_hits;  /* Boxed Ints served from the small-int table */
+  long chunks;          /* Arena chunks obtained from malloc */
+};
+extern struct quack_alloc_stats quack_stats;
+
+#ifdef QUACK_ALLOC_STATS
+#define COUNT_ALLOC(counter) (quack_stats.counter++)
+#else
+#define COUNT_ALLOC(counter) ((void) 0)
+#endif
+
+/* Inline caches.  A call the compiler cannot bind to a single 
+ * method compares the receiver's method table entry with up to 
+ * four implementations from the class hierarchy and calls the 
+ * matching one directly, falling back to the table.  Compile 
+ * with -DQUACK_IC_STATS to count hits and misses at each such 
+ * call site and report them on stderr at exit. 
+ */
+#define QUACK_SAME_FN(a, b) ((void (*)(void)) (a) == (void (*)(void)) (b))
+
+struct quack_ic_site {
+  const char *where;    /* Method containing the call, and the call */
+  long hits;
+  long misses;
+  struct quack_ic_site *next;  /* Sites reached so far */
+};
+extern void quack_ic_count(struct quack_ic_site *site, int hit);
+
+#ifdef QUACK_IC_STATS
+#define QUACK_IC_SITE(site, where) \
+  static struct quack_ic_site site = { where, 0, 0, NULL }
+#define QUACK_IC_HIT(site) quack_ic_count(&site, 1)
+#define QUACK_IC_MISS(site) quack_ic_count(&site, 0)
+#else
+#define QUACK_IC_SITE(site, where) extern struct quack_ic_site site
+#define QUACK_IC_HIT(site) ((void) 0)
+#define QUACK_IC_MISS(site) ((void) 0)
+#endif
+
+/* Tail call trampoline.  A method whose tail calls go through it is 
+ * compiled as a body, which stores the callee and its arguments in 
+ * quack_tail and returns QUACK_TAIL_PENDING, and an entry point that 
+ * calls the body and then quack_run_tail, which makes the pending 
+ * calls one after another until one returns a value.  A chain of such 
+ * tail calls thus runs in constant stack. 
+ */
+#define QUACK_TAIL_MAX_ARGS 8
+
+struct quack_tail_call {
+  void (*fn)(void);
+  int nargs;            /* Receiver included */
+  obj_Obj args[QUACK_TAIL_MAX_ARGS];
+};
+extern struct quack_tail_call quack_tail;
+
+#define QUACK_TAIL_PENDING ((obj_Obj) &quack_tail)
+extern obj_Obj quack_run_tail(void);
+
 #endif
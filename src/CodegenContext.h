@@ -13,10 +13,42 @@
 #define AST_CODEGENCONTEXT_H
 
 #include <ostream>
+#include <iostream>
+#include <sstream>
 #include <map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include "IR.h"
 
 using namespace std;
 
+/* Int and String literals are emitted once, as statically initialized
+ * objects at file scope, rather than boxed at every evaluation.  The
+ * pool is shared by every context derived from the same root context
+ * and is printed by Program::gen_rval ahead of the code that uses it.
+ */
+struct ConstPool {
+    map<int, string> ints;     // value -> name of static obj_Int_struct
+    map<string, string> strs;  // text -> name of static obj_String_struct
+};
+
+/* The method being compiled, as seen by calls in tail position.  A
+ * call to the method itself reassigns its parameters (this, then the
+ * formals) and jumps back to the start; a call to another method
+ * leaves this one in constant stack (IR_TAILCALL).
+ */
+struct TailTarget {
+    string function;
+    vector<string> params;
+};
+
+/* The values from low to high (inclusive) of a switch, and where they go */
+struct SwitchCase {
+    int low, high;
+    string target;
+};
+
 class CodegenContext {
     // In place of registers, we'll use local integer variables.
     // Declarations are tricky if we reuse variable names, so we'll
@@ -24,10 +56,247 @@ class CodegenContext {
     int next_reg_num = 0;
     int next_label_num = 0;
     map<string, string> vars;
-    ostream &object_code;
+    set<string> unboxed_vars; // locals held as raw C ints
+    ostream *object_code;
+    ConstPool *consts;
+    // Within a function body, code is built up as IR rather than
+    // written out; end_function lowers it to C.
+    IRFunction *fn = nullptr;
+    // Within the body of a method inlined at a call site: the register
+    // holding its receiver, a prefix keeping its variables apart from
+    // the caller's, and where its result goes on return
+    string self = "this";
+    string var_prefix;
+    string return_reg, return_label;
+    CodegenContext(ostream &out, ConstPool *pool, bool unbox, IROptions *opts) :
+        object_code{&out}, consts{pool}, unbox_prims{unbox}, ir_opts{opts} {};
+
+    void declare(string ctype, string name, string init, string comment) {
+        if (fn == nullptr) {
+            *object_code << ctype << " " << name << ";" << comment << endl;
+            return;
+        }
+        fn->declare(ctype, name, init, comment);
+    }
+
+    void append(const IRInstr &instr) {
+        if (fn == nullptr) {
+            cerr << "*** IR emitted outside a function ***" << endl; exit(1);
+        }
+        fn->append(instr);
+    }
 public:
-    explicit CodegenContext(ostream &out) : object_code{out} {};
-    void emit(string s) { object_code << "" << s  << endl; }
+    // Typed lowering: keep Int and Boolean locals and intermediate
+    // results as C ints, boxing only where an object is required.
+    bool unbox_prims = true;
+    // How each generated function is optimized and reported on,
+    // shared like the literal pool
+    IROptions *ir_opts;
+
+    // Methods being inlined here, outermost first, and the AST nodes
+    // inlined into the current function so far
+    vector<string> inlining;
+    int inlined = 0;
+    // Within a method (not a constructor or the main program)
+    TailTarget *tail = nullptr;
+
+    explicit CodegenContext(ostream &out) :
+        object_code{&out}, consts{new ConstPool()}, ir_opts{new IROptions()} {};
+    void emit(string s) {
+        if (fn != nullptr) {
+            IRInstr c(IR_C);
+            c.name = s;
+            fn->append(c);
+            return;
+        }
+        *object_code << "" << s  << endl;
+    }
+
+    /* A context with no registers or variables yet (e.g., for a new
+     * class or function body) that still writes to the same output
+     * and shares the same literal pool.
+     */
+    CodegenContext fresh() { return CodegenContext(*object_code, consts, unbox_prims, ir_opts); }
+    CodegenContext fresh(ostream &out) { return CodegenContext(out, consts, unbox_prims, ir_opts); }
+
+    /* Bracket the body of a generated C function.  Code emitted in
+     * between is collected in f; end_function optimizes it, then writes
+     * its declarations, a GC frame registering each object-valued local
+     * (and any roots added with add_root, such as parameters), and the
+     * body.
+     */
+    void begin_function(IRFunction &f) { fn = &f; }
+    void add_root(string name) { fn->params.push_back(name); }
+
+    string function_name() { return fn->name; }
+    void end_function() {
+        if (ir_opts->optimize) { fn->optimize(*ir_opts); }
+        if (ir_opts->dump != nullptr) { fn->dump(*ir_opts->dump); }
+        fn->print_c(*object_code, ir_opts->trampolined);
+        fn = nullptr;
+    }
+
+    /* Three-address instructions for the current function.  Operands
+     * are the names returned by alloc_reg, get_var, and the like.
+     */
+    void emit_move(string dest, string src, string note = "") {
+        // Instance variables come back from get_var as this->var_x
+        // (or, inlined, the receiver's register in place of this)
+        size_t arrow = src.find("->");
+        if (arrow != string::npos) {
+            IRInstr i(IR_GETFIELD);
+            i.dest = dest; i.args = {src.substr(0, arrow)}; i.name = src.substr(arrow + 2); i.note = note;
+            append(i);
+            return;
+        }
+        arrow = dest.find("->");
+        if (arrow != string::npos) {
+            emit_setfield(dest.substr(0, arrow), dest.substr(arrow + 2), src);
+            return;
+        }
+        IRInstr i(IR_MOVE);
+        i.dest = dest; i.args = {src}; i.note = note;
+        append(i);
+    }
+    /* Copy converting to obj_<cast> */
+    void emit_cast(string dest, string cast, string src) {
+        IRInstr i(IR_MOVE);
+        i.dest = dest; i.args = {src}; i.cast = cast;
+        append(i);
+    }
+    void emit_setfield(string obj, string field, string src) {
+        IRInstr i(IR_SETFIELD);
+        i.args = {obj, src}; i.name = field;
+        append(i);
+    }
+    void emit_prim(string dest, string op, string left, string right) {
+        IRInstr i(IR_PRIM);
+        i.dest = dest; i.name = op; i.args = {left, right};
+        append(i);
+    }
+    void emit_not(string dest, string src) {
+        IRInstr i(IR_NOT);
+        i.dest = dest; i.args = {src};
+        append(i);
+    }
+    void emit_box(string dest, string type, string prim, string note = "") {
+        IRInstr i(IR_BOX);
+        i.dest = dest; i.name = type; i.args = {prim}; i.note = note;
+        append(i);
+    }
+    void emit_unbox(string dest, string src) {
+        IRInstr i(IR_UNBOX);
+        i.dest = dest; i.args = {src};
+        append(i);
+    }
+    /* Direct call; a non-empty cast names the class the first argument
+     * (the receiver of a method) is converted to.
+     */
+    void emit_call(string dest, string callee, string cast, vector<string> args) {
+        IRInstr i(IR_CALL);
+        i.dest = dest; i.name = callee; i.cast = cast; i.args = args;
+        append(i);
+    }
+    /* Call through the receiver's method table, first checking the
+     * method table entry against each of impls in turn.
+     */
+    void emit_dispatch(string dest, string method, vector<string> args,
+                       vector<string> impls, string site_name) {
+        IRInstr i(IR_DISPATCH);
+        i.dest = dest; i.name = method; i.args = args; i.targets = impls;
+        if (impls.size() > 0) {
+            i.label = new_branch_label("ic");
+            i.note = site_name;
+        }
+        append(i);
+    }
+    void emit_new(string dest, string cname, vector<string> args) {
+        IRInstr i(IR_NEW);
+        i.dest = dest; i.name = cname; i.args = args;
+        append(i);
+    }
+    void emit_alloc(string dest, string cname) {
+        IRInstr i(IR_ALLOC);
+        i.dest = dest; i.name = cname;
+        append(i);
+    }
+    void emit_label(string label) {
+        IRInstr i(IR_LABEL);
+        i.label = label;
+        append(i);
+    }
+    void emit_jump(string label, string note = "") {
+        IRInstr i(IR_JUMP);
+        i.label = label; i.note = note;
+        append(i);
+    }
+    void emit_branch(string cond, string true_branch, string false_branch) {
+        IRInstr i(IR_BRANCH);
+        i.args = {cond}; i.targets = {true_branch, false_branch};
+        append(i);
+    }
+    /* Branch on a comparison of two C ints */
+    void emit_branch(string op, string left, string right, string true_branch, string false_branch) {
+        IRInstr i(IR_BRANCH);
+        i.name = op; i.args = {left, right}; i.targets = {true_branch, false_branch};
+        append(i);
+    }
+    /* Branch on a C int to the label of the case whose range holds it, if any */
+    void emit_switch(string selector, vector<SwitchCase> cases, string default_branch) {
+        IRInstr i(IR_SWITCH);
+        i.args = {selector}; i.targets = {default_branch};
+        for (const SwitchCase &c: cases) {
+            if (c.low == c.high) {
+                i.args.push_back(to_string(c.low));
+            } else {
+                i.args.push_back(to_string(c.low) + " ... " + to_string(c.high));
+            }
+            i.targets.push_back(c.target);
+        }
+        append(i);
+    }
+    /* A self tail call.  The values are all evaluated already (into
+     * registers, never the parameters themselves), so the parameters
+     * can be reassigned in turn; the receiver is converted to cast.
+     */
+    void emit_tail_jump(string cast, vector<string> values) {
+        for (int p = 0; p < values.size(); p++) {
+            if (p == 0 && cast != "") {
+                emit_cast(tail->params[p], cast, values[p]);
+            } else {
+                emit_move(tail->params[p], values[p]);
+            }
+        }
+        emit_jump(fn->entry_label(), "Tail call");
+    }
+    /* Return the result of a call to another method, directly or (as
+     * emit_dispatch) through the method table, without growing the stack.
+     */
+    void emit_tail_call(string callee, string cast, vector<string> args) {
+        IRInstr i(IR_TAILCALL);
+        i.name = callee; i.cast = cast; i.args = args;
+        append(i);
+    }
+    void emit_tail_dispatch(string method, vector<string> args, vector<string> impls,
+                            string site_name) {
+        IRInstr i(IR_TAILCALL);
+        i.name = method; i.args = args; i.targets = impls;
+        i.label = new_branch_label("ic");
+        i.note = site_name;
+        append(i);
+    }
+    /* Is a value returned here returned from the C function? */
+    bool in_tail_position() { return return_label == ""; }
+    void emit_return(string value) {
+        if (return_label != "") {
+            emit_move(return_reg, value);
+            emit_jump(return_label, "Return from inlined method");
+            return;
+        }
+        IRInstr i(IR_RETURN);
+        i.args = {value};
+        append(i);
+    }
 
     /* Getting the name of a "register" (really a local variable in C)
      * has the side effect of emitting a declaration for the variable.
@@ -36,13 +305,22 @@ public:
     string alloc_reg(string type) {
         int reg_num = next_reg_num++;
         string reg_name = "tmp__" + to_string(reg_num);
-        object_code<<"obj_"<<type<<" "<<reg_name<< ";"<<endl;
+        declare("obj_"+type, reg_name, "NULL", "");
+        return reg_name;
+    }
+
+    /* A "register" for an unboxed Int or Boolean */
+    string alloc_prim_reg() {
+        int reg_num = next_reg_num++;
+        string reg_name = "tmp__" + to_string(reg_num);
+        declare("int", reg_name, "0", "");
         return reg_name;
     }
 
     void free_reg(string reg) {
-        // We don't have real registers, so there is nothing to free.
-        this->emit(string("// Free ") + reg);
+        // Nothing to do here: once the function is complete and
+        // liveness is known, IRFunction::reuse_temps gives temporaries
+        // that are never live together the same C local.
     }
 
     /* Get internal name for a calculator variable.
@@ -52,6 +330,7 @@ public:
      */
     //string get_var(string &ident) {
     string get_var(string &ident, string type){
+        if (ident == "this") { return self; } // The receiver, a parameter
         int is_dot=0;
         if (ident.find(".")!=string::npos){
             string replaced = "";
@@ -63,31 +342,146 @@ public:
             is_dot=1;
         }
         if (vars.count(ident) == 0) {
-            string internal = string("var_") + ident;
+            string internal = string("var_") + var_prefix + ident;
             vars[ident] = internal;
             // We'll need a declaration in the generated code
-            this->emit(string("obj_"+type+" ") + internal + "; // Source variable " + ident);
+            if (!is_dot && is_prim(type)) {
+                unboxed_vars.insert(ident);
+                declare("int", internal, "0", " // Source variable " + ident + " (unboxed " + type + ")");
+                return internal;
+            }
+            declare("obj_"+type, internal, "NULL", " // Source variable " + ident);
             return internal;
         }
         if (is_dot){
-            return "this->"+vars[ident];
+            return self+"->"+vars[ident];
         }
         return vars[ident];
     }
 
     void set_var(string &ident, string val){ vars[ident] = val; }
 
+    /* A context for the body of a method inlined into the current
+     * function.  It has none of the caller's variables: the callee's own
+     * are named with a prefix unique to this call site, and its instance
+     * variables (fields, like this.x) are reached through self.  Registers
+     * and labels continue the caller's numbering; end_inline hands the
+     * numbering back.  Returns leave their value in result, or, with no
+     * result (the call being in tail position), return from the function.
+     */
+    CodegenContext inline_frame(string self_reg, vector<string> fields, string callee, string result) {
+        CodegenContext frame = *this;
+        frame.vars.clear();
+        frame.unboxed_vars.clear();
+        frame.self = self_reg;
+        string site = frame.new_branch_label("inline");
+        frame.var_prefix = site + "_";
+        frame.return_reg = result;
+        frame.return_label = result == "" ? "" : "end" + site;
+        for (string f: fields) {
+            string ident;
+            for (char c: f) { ident += c == '.' ? string("__") : string(1, c); }
+            frame.vars[ident] = "var_" + ident;
+        }
+        frame.inlining.push_back(callee);
+        return frame;
+    }
+    void end_inline(CodegenContext &frame) {
+        next_reg_num = frame.next_reg_num;
+        next_label_num = frame.next_label_num;
+        inlined = frame.inlined;
+        if (frame.return_label != "") { emit_label(frame.return_label); }
+    }
+
+    /* Bind a formal of the inlined method to the value of its actual,
+     * in a register so that the copy can be forwarded
+     */
+    string bind_var(string ident, string type, string value) {
+        string reg = alloc_reg(type);
+        vars[ident] = reg;
+        emit_move(reg, value, "Inlined formal " + ident);
+        return reg;
+    }
+
+    /* Int and Boolean values can be carried unboxed */
+    bool is_prim(string type) {
+        return unbox_prims && (type == "Int" || type == "Boolean");
+    }
+
+    /* Is this source variable a local held as a raw C int? */
+    bool is_unboxed(string ident) { return unboxed_vars.count(ident) != 0; }
+
     string define_class_structs(string &ident){
         // ensure all class objects are defined before use/reference
         string internal = string("obj_") + ident;
         this->emit("struct obj_"+ident+"_struct;");
         this->emit("typedef struct obj_"+ident+"_struct *obj_"+ident+";");
         this->emit("struct class_"+ident+"_struct;");
-        this->emit("typedef struct class_"+ident+"_struct *class_"+ident+";");
+        this->emit("typedef const struct class_"+ident+"_struct *class_"+ident+";");
         vars[ident] = internal; // ???
         return internal;
     }
 
+    /* Reference to the pooled static object for an Int or String
+     * literal.  The object itself is declared by emit_const_pool.
+     */
+    string int_const(int value) {
+        if (consts->ints.count(value) == 0) {
+            string suffix = value < 0 ? "m" + to_string(-(long) value) : to_string(value);
+            consts->ints[value] = "lit_int_" + suffix;
+        }
+        return "(&" + consts->ints[value] + ")";
+    }
+
+    string str_const(const string &text) {
+        if (consts->strs.count(text) == 0) {
+            string name = "lit_str_" + to_string(consts->strs.size());
+            consts->strs[text] = name;
+        }
+        return "(&" + consts->strs[text] + ")";
+    }
+
+    void emit_const_pool() {
+        for (auto &c: consts->ints) {
+            this->emit("struct obj_Int_struct " + c.second +
+                       " = { GC_STATIC, &the_class_Int_struct, " + to_string(c.first) + " };");
+        }
+        for (auto &c: consts->strs) {
+            this->emit("struct obj_String_struct " + c.second +
+                       " = { GC_STATIC, &the_class_String_struct, " + c_string(c.first) + ", "
+                       + to_string(c.first.size()) + ", " + to_string(str_hash(c.first)) + "u };");
+        }
+        if (consts->ints.size() + consts->strs.size() != 0) { this->emit(""); }
+    }
+
+    /* Hash of a String's bytes, matching str_hash in Builtins.c
+     * (32-bit FNV-1a, with 0 reserved for "not yet computed").
+     */
+    static unsigned int str_hash(const string &text) {
+        uint32_t h = 2166136261u;
+        for (char c: text) {
+            h = (h ^ (unsigned char) c) * 16777619u;
+        }
+        return h == 0 ? 1 : h;
+    }
+
+    /* Quote text as a C string literal */
+    static string c_string(const string &text) {
+        string quoted = "\"";
+        for (char c: text) {
+            switch (c) {
+                case '\n': quoted += "\\n"; break;
+                case '\t': quoted += "\\t"; break;
+                case '\r': quoted += "\\r"; break;
+                case '\0': quoted += "\\000"; break;
+                case '"':  quoted += "\\\""; break;
+                case '\\': quoted += "\\\\"; break;
+                default: quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
     /* Get a new, unique branch label.  We use a prefix
      * string just to make the object code a little more
      * readable by indicating what the label was for
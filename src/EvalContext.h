@@ -1,4 +1,3 @@
-  
 //
 // A context object for 'eval' methods.
 // We need to carry a symbol table for variables that have
@@ -9,16 +8,34 @@
 #ifndef AST_EVALCONTEXT_H
 #define AST_EVALCONTEXT_H
 
+#include <string>
+#include <map>
 #include <unordered_map>
 
+// A value known at compile time: an Int, a String, or a Boolean
+// (held in num as 0 or 1).
+//
+struct ConstValue {
+    std::string type;
+    int num = 0;
+    std::string text;
+};
+
 // EvalContext is really just a struct for passing around the
 // context.  There is no attempt at information hiding here.
 //
+// eval folds constants one method at a time.  assigns counts the
+// assignments to each variable of the method, and symtab holds the
+// values of those assigned exactly once, to a constant, as eval
+// reaches them.
+//
 class EvalContext {
 public:
-    std::unordered_map<std::string,int> symtab;
+    std::unordered_map<std::string,ConstValue> symtab;
+    std::map<std::string,int> assigns;
+    ConstValue value;  // Result of the last eval that returned 1
     explicit EvalContext() { }
 };
 
 
-#endif //AST_EVALCONTEXT_H
\ No newline at end of file
+#endif //AST_EVALCONTEXT_H
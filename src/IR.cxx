@@ -0,0 +1,949 @@
+//
+// Optimization passes over the three-address IR of one generated
+// C function (see IR.h).
+//
+
+#include "IR.h"
+#include <iostream>
+#include <algorithm>
+
+/* Built-in methods and constructors that have no effect besides
+ * allocating and returning their result.  Int DIVIDE can trap on zero
+ * and the PRINTs write output, so they are not among them.
+ */
+static const set<string> pure_builtins = {
+    "new_Obj", "Obj_method_STR", "Obj_method_EQUALS",
+    "new_String", "String_method_STR", "String_method_EQUALS",
+    "String_method_LESS", "String_method_PLUS",
+    "new_Boolean", "Boolean_method_STR",
+    "new_Nothing", "Nothing_method_STR",
+    "new_Int", "Int_method_STR", "Int_method_EQUALS", "Int_method_LESS",
+    "Int_method_GREATER", "Int_method_ATMOST", "Int_method_ATLEAST",
+    "Int_method_PLUS", "Int_method_MINUS", "Int_method_TIMES",
+    "str_equal", "str_compare"
+};
+
+/* Built-in methods that write output but leave every object alone */
+static const set<string> output_builtins = { "Int_method_PRINT", "String_method_PRINT" };
+
+bool IRInstr::is_pure(const set<string> &pure_methods) const {
+    switch (op) {
+        case IR_MOVE: case IR_NOT: case IR_BOX: case IR_UNBOX: case IR_GETFIELD:
+            return true;
+        case IR_PRIM:
+            return name != "/";  // Division by zero traps
+        case IR_CALL:
+            return pure_builtins.count(name) != 0 || pure_methods.count(name) != 0;
+        case IR_NEW:
+            return pure_builtins.count("new_" + name) != 0;
+        default:
+            return false;
+    }
+}
+
+/* Successors, predecessors and immediate dominators (by the iterative
+ * method of Cooper, Harvey and Kennedy) of the blocks of a function.
+ * Blocks must all be reachable.
+ */
+struct FlowGraph {
+    vector<vector<int>> succ, preds;
+    vector<int> idom;
+
+    explicit FlowGraph(const IRFunction &fn) {
+        int n = fn.blocks.size();
+        map<string, int> index = fn.block_index();
+        succ.resize(n);
+        preds.resize(n);
+        for (int b = 0; b < n; b++) {
+            succ[b] = fn.successors(b, index);
+            for (int s: succ[b]) { preds[s].push_back(b); }
+        }
+
+        vector<int> order;           // Reverse postorder
+        vector<int> rpo_num(n, -1);
+        vector<bool> visited(n, false);
+        vector<pair<int, int>> stack = {{0, 0}};
+        visited[0] = true;
+        while (!stack.empty()) {
+            int b = stack.back().first;
+            int &next = stack.back().second;
+            if (next < succ[b].size()) {
+                int s = succ[b][next++];
+                if (!visited[s]) {
+                    visited[s] = true;
+                    stack.push_back({s, 0});
+                }
+            } else {
+                order.push_back(b);
+                stack.pop_back();
+            }
+        }
+        reverse(order.begin(), order.end());
+        for (int i = 0; i < order.size(); i++) { rpo_num[order[i]] = i; }
+
+        idom.assign(n, -1);
+        idom[0] = 0;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int b: order) {
+                if (b == 0) { continue; }
+                int new_idom = -1;
+                for (int p: preds[b]) {
+                    if (idom[p] == -1) { continue; }
+                    if (new_idom == -1) { new_idom = p; continue; }
+                    int f1 = p, f2 = new_idom;
+                    while (f1 != f2) {
+                        while (rpo_num[f1] > rpo_num[f2]) { f1 = idom[f1]; }
+                        while (rpo_num[f2] > rpo_num[f1]) { f2 = idom[f2]; }
+                    }
+                    new_idom = f1;
+                }
+                if (idom[b] != new_idom) {
+                    idom[b] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    bool dominates(int a, int b) const {
+        while (b != a && b != 0) { b = idom[b]; }
+        return b == a;
+    }
+
+    /* Blocks of the loop entered at header: it and everything that
+     * reaches one of its latches (the blocks branching back to it)
+     * without passing through it
+     */
+    set<int> loop_body(int header) const {
+        set<int> body = {header};
+        vector<int> work;
+        for (int p: preds[header]) {
+            if (dominates(header, p) && body.insert(p).second) { work.push_back(p); }
+        }
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int p: preds[b]) {
+                if (body.insert(p).second) { work.push_back(p); }
+            }
+        }
+        return body;
+    }
+};
+
+/* Static single assignment form of a function, kept alongside the IR
+ * rather than rewriting it: every definition of a variable (by an
+ * instruction, by a phi where control flow joins, or on entry to the
+ * function) is numbered, and every use of a variable is linked to the
+ * one definition that reaches it.  Blocks must all be reachable.
+ */
+class SSAForm {
+public:
+    enum DefKind { DEF_ENTRY, DEF_INSTR, DEF_PHI };
+    struct Def {
+        DefKind kind;
+        int block;
+        int index;            // Of the instruction, for DEF_INSTR
+        vector<int> operands; // One per predecessor, for DEF_PHI
+    };
+    vector<Def> defs;
+    vector<vector<vector<int>>> use_defs;  // [block][instr]: def reaching each use
+    vector<vector<int>> instr_def;         // [block][instr]: def made, or -1
+
+    explicit SSAForm(const IRFunction &f) : fn(f), flow(f), succ(flow.succ), preds(flow.preds) {
+        find_frontiers();
+        place_phis();
+        rename();
+    }
+
+private:
+    const IRFunction &fn;
+    FlowGraph flow;
+    const vector<vector<int>> &succ, &preds;
+    vector<vector<int>> dom_children;
+    vector<set<int>> frontier;
+    map<string, int> var_ids;
+    vector<map<int, int>> phis;   // [block]: variable -> phi def
+
+    int var_id(const string &var) {
+        if (var_ids.count(var) == 0) {
+            int id = var_ids.size();
+            var_ids[var] = id;
+        }
+        return var_ids[var];
+    }
+
+    int new_def(DefKind kind, int block, int index) {
+        Def d;
+        d.kind = kind;
+        d.block = block;
+        d.index = index;
+        defs.push_back(d);
+        return defs.size() - 1;
+    }
+
+    /* Dominator tree and dominance frontiers */
+    void find_frontiers() {
+        int n = fn.blocks.size();
+        const vector<int> &idom = flow.idom;
+        dom_children.assign(n, vector<int>());
+        frontier.assign(n, set<int>());
+        for (int b = 1; b < n; b++) { dom_children[idom[b]].push_back(b); }
+        for (int b = 0; b < n; b++) {
+            if (preds[b].size() < 2) { continue; }
+            for (int p: preds[b]) {
+                for (int r = p; r != idom[b]; r = idom[r]) { frontier[r].insert(b); }
+            }
+        }
+    }
+
+    /* A phi for each variable at the iterated dominance frontier of
+     * the blocks that assign it
+     */
+    void place_phis() {
+        int n = fn.blocks.size();
+        vector<set<int>> def_blocks;
+        for (int b = 0; b < n; b++) {
+            for (const IRInstr &i: fn.blocks[b].code) {
+                if (i.dest == "") { continue; }
+                int v = var_id(i.dest);
+                if (v >= def_blocks.size()) { def_blocks.resize(v + 1); }
+                def_blocks[v].insert(b);
+            }
+        }
+        phis.assign(n, map<int, int>());
+        for (int v = 0; v < def_blocks.size(); v++) {
+            vector<int> work(def_blocks[v].begin(), def_blocks[v].end());
+            while (!work.empty()) {
+                int b = work.back();
+                work.pop_back();
+                for (int d: frontier[b]) {
+                    if (phis[d].count(v) != 0) { continue; }
+                    int phi = new_def(DEF_PHI, d, -1);
+                    defs[phi].operands.assign(preds[d].size(), -1);
+                    phis[d][v] = phi;
+                    if (def_blocks[v].count(d) == 0) { work.push_back(d); }
+                }
+            }
+        }
+    }
+
+    /* Walk the dominator tree keeping, for each variable, a stack of
+     * the definitions in scope.
+     */
+    void rename() {
+        int n = fn.blocks.size();
+        use_defs.assign(n, vector<vector<int>>());
+        instr_def.assign(n, vector<int>());
+        for (const IRBlock &b: fn.blocks) {
+            for (const IRInstr &i: b.code) {
+                for (const string &u: i.uses()) { var_id(u); }
+            }
+        }
+        vector<vector<int>> stacks(var_ids.size());
+        for (int v = 0; v < stacks.size(); v++) {
+            stacks[v].push_back(new_def(DEF_ENTRY, 0, -1));
+        }
+
+        // Each block is visited twice: to define, then to pop its
+        // definitions once its subtree is done
+        vector<pair<int, bool>> walk = {{0, false}};
+        vector<vector<int>> pushed(n);
+        while (!walk.empty()) {
+            int b = walk.back().first;
+            bool done = walk.back().second;
+            walk.pop_back();
+            if (done) {
+                for (int v: pushed[b]) { stacks[v].pop_back(); }
+                continue;
+            }
+            for (auto &p: phis[b]) {
+                stacks[p.first].push_back(p.second);
+                pushed[b].push_back(p.first);
+            }
+            const vector<IRInstr> &code = fn.blocks[b].code;
+            use_defs[b].resize(code.size());
+            instr_def[b].assign(code.size(), -1);
+            for (int k = 0; k < code.size(); k++) {
+                for (const string &u: code[k].uses()) {
+                    use_defs[b][k].push_back(stacks[var_ids[u]].back());
+                }
+                if (code[k].dest != "") {
+                    int v = var_ids[code[k].dest];
+                    int d = new_def(DEF_INSTR, b, k);
+                    instr_def[b][k] = d;
+                    stacks[v].push_back(d);
+                    pushed[b].push_back(v);
+                }
+            }
+            for (int s: succ[b]) {
+                for (int j = 0; j < preds[s].size(); j++) {
+                    if (preds[s][j] != b) { continue; }
+                    for (auto &p: phis[s]) {
+                        defs[p.second].operands[j] = stacks[p.first].back();
+                    }
+                }
+            }
+            walk.push_back({b, true});
+            for (int c: dom_children[b]) { walk.push_back({c, false}); }
+        }
+    }
+};
+
+int IRFunction::remove_unreachable() {
+    map<string, int> index = block_index();
+    vector<bool> reached(blocks.size(), false);
+    vector<int> work = {0};
+    reached[0] = true;
+    while (!work.empty()) {
+        int b = work.back();
+        work.pop_back();
+        for (int s: successors(b, index)) {
+            if (!reached[s]) {
+                reached[s] = true;
+                work.push_back(s);
+            }
+        }
+    }
+    int removed = 0;
+    vector<IRBlock> kept;
+    for (int b = 0; b < blocks.size(); b++) {
+        if (reached[b]) {
+            kept.push_back(blocks[b]);
+        } else {
+            removed += blocks[b].code.size();
+        }
+    }
+    blocks = kept;
+    return removed;
+}
+
+/* Mark the instructions that have effects besides their result, then
+ * everything they use, following SSA def-use links (through phis) back
+ * to the definitions that reach them.  What is left unmarked computes
+ * a value no effect depends on.
+ */
+int IRFunction::eliminate_dead_code(const set<string> &pure_methods) {
+    for (const IRBlock &b: blocks) {
+        for (const IRInstr &i: b.code) {
+            if (i.op == IR_C) { return 0; }  // Could read anything
+        }
+    }
+    SSAForm ssa(*this);
+    vector<vector<bool>> live(blocks.size());
+    vector<bool> def_live(ssa.defs.size(), false);
+    vector<int> work;
+    for (int b = 0; b < blocks.size(); b++) {
+        live[b].assign(blocks[b].code.size(), false);
+        for (int k = 0; k < blocks[b].code.size(); k++) {
+            if (blocks[b].code[k].is_pure(pure_methods)) { continue; }
+            live[b][k] = true;
+            for (int d: ssa.use_defs[b][k]) { work.push_back(d); }
+        }
+    }
+    while (!work.empty()) {
+        int d = work.back();
+        work.pop_back();
+        if (def_live[d]) { continue; }
+        def_live[d] = true;
+        const SSAForm::Def &def = ssa.defs[d];
+        if (def.kind == SSAForm::DEF_PHI) {
+            for (int o: def.operands) { work.push_back(o); }
+        } else if (def.kind == SSAForm::DEF_INSTR && !live[def.block][def.index]) {
+            live[def.block][def.index] = true;
+            for (int u: ssa.use_defs[def.block][def.index]) { work.push_back(u); }
+        }
+    }
+    int removed = 0;
+    for (int b = 0; b < blocks.size(); b++) {
+        vector<IRInstr> kept;
+        for (int k = 0; k < blocks[b].code.size(); k++) {
+            if (live[b][k]) {
+                kept.push_back(blocks[b].code[k]);
+            } else {
+                removed++;
+            }
+        }
+        blocks[b].code = kept;
+    }
+    return removed;
+}
+
+/* Number of definitions and of uses of each variable */
+static void count_refs(const vector<IRBlock> &blocks, map<string, int> &defs, map<string, int> &uses) {
+    for (const IRBlock &b: blocks) {
+        for (const IRInstr &i: b.code) {
+            if (i.dest != "") { defs[i.dest]++; }
+            for (const string &u: i.uses()) { uses[u]++; }
+        }
+    }
+}
+
+/* Replace uses of a temporary that only copies another value with the
+ * value itself.  A constant can stand in anywhere its single definition
+ * reaches; a variable only later in the same block and only until it is
+ * assigned again.  The copies left with no uses are then dead.
+ */
+int IRFunction::propagate_copies() {
+    map<string, int> defs, uses;
+    count_refs(blocks, defs, uses);
+    SSAForm ssa(*this);
+    // The definition each constant copy makes, and its value
+    map<int, string> const_copies;
+    map<string, int> const_copy_def;
+    for (int b = 0; b < blocks.size(); b++) {
+        for (int k = 0; k < blocks[b].code.size(); k++) {
+            const IRInstr &i = blocks[b].code[k];
+            if (i.op == IR_MOVE && i.cast == "" && IRInstr::is_temp(i.dest) && defs[i.dest] == 1
+                    && !IRInstr::is_var(i.args[0])) {
+                const_copies[ssa.instr_def[b][k]] = i.args[0];
+                const_copy_def[i.dest] = ssa.instr_def[b][k];
+            }
+        }
+    }
+    int replaced = 0;
+    for (int b = 0; b < blocks.size(); b++) {
+        vector<IRInstr> &code = blocks[b].code;
+        for (int k = 0; k < code.size(); k++) {
+            int u = 0;
+            for (string &a: code[k].args) {
+                if (!IRInstr::is_var(a)) { continue; }
+                int reaching = ssa.use_defs[b][k][u++];
+                if (const_copy_def.count(a) != 0 && const_copy_def[a] == reaching) {
+                    a = const_copies[reaching];
+                    replaced++;
+                }
+            }
+        }
+        // Copies of variables, within the block
+        for (int k = 0; k < code.size(); k++) {
+            // A conversion (the receiver of an inlined method) has to stay
+            if (code[k].op != IR_MOVE || code[k].cast != "" || !IRInstr::is_temp(code[k].dest)
+                    || !IRInstr::is_var(code[k].args[0]) || defs[code[k].dest] != 1) {
+                continue;
+            }
+            string temp = code[k].dest, source = code[k].args[0];
+            for (int j = k + 1; j < code.size(); j++) {
+                for (string &a: code[j].args) {
+                    if (a == temp) {
+                        a = source;
+                        replaced++;
+                    }
+                }
+                if (code[j].dest == source) { break; }
+            }
+        }
+    }
+    return replaced;
+}
+
+/* Compute a value straight into the variable it is copied to, when the
+ * temporary holding it is used for nothing else: t = e; ... x = t
+ * becomes x = e when nothing in between mentions x.
+ */
+int IRFunction::coalesce_copies() {
+    map<string, int> defs, uses;
+    count_refs(blocks, defs, uses);
+    int coalesced = 0;
+    for (IRBlock &b: blocks) {
+        vector<IRInstr> &code = b.code;
+        map<string, int> def_at;  // Where each temporary is defined in the block
+        vector<bool> deleted(code.size(), false);
+        for (int k = 0; k < code.size(); k++) {
+            const IRInstr &i = code[k];
+            if (i.op == IR_MOVE && i.cast == "" && IRInstr::is_temp(i.args[0]) && IRInstr::is_var(i.dest)
+                    && def_at.count(i.args[0]) != 0 && defs[i.args[0]] == 1 && uses[i.args[0]] == 1) {
+                int d = def_at[i.args[0]];
+                bool clear = true;
+                for (int j = d + 1; j < k && clear; j++) {
+                    if (deleted[j]) { continue; }
+                    const vector<string> &args = code[j].args;
+                    clear = code[j].dest != i.dest && find(args.begin(), args.end(), i.dest) == args.end();
+                }
+                if (clear) {
+                    code[d].dest = i.dest;
+                    deleted[k] = true;
+                    coalesced++;
+                    continue;
+                }
+            }
+            if (IRInstr::is_temp(i.dest)) { def_at[i.dest] = k; }
+        }
+        vector<IRInstr> kept;
+        for (int k = 0; k < code.size(); k++) {
+            if (!deleted[k]) { kept.push_back(code[k]); }
+        }
+        code = kept;
+    }
+    return coalesced;
+}
+
+/* Global value numbering, over the dominator tree.  An instruction
+ * computing what a variable assigned only once already holds, from a
+ * dominating position, becomes a copy of it.  Operands are identified
+ * by the definitions reaching them (SSAForm), seen through copies, so
+ * equal keys mean equal values; unboxing an Int just boxed gives back
+ * what was boxed.  Field loads, and calls to pure user methods (which read
+ * fields), also depend on memory, known only along a chain of blocks
+ * each the single predecessor of the next: a store to a field ends the
+ * loads of it known so far (and makes its value known), and a call that
+ * might store to any field ends them all.
+ */
+class ValueNumbering {
+public:
+    int replaced = 0;
+
+    ValueNumbering(IRFunction &f, const set<string> &pure) : fn(f), pure_methods(pure), ssa(f), flow(f) {
+        count_refs(fn.blocks, defs, uses);
+        children.resize(fn.blocks.size());
+        for (int b = 1; b < fn.blocks.size(); b++) { children[flow.idom[b]].push_back(b); }
+        visit(0);
+    }
+
+private:
+    IRFunction &fn;
+    const set<string> &pure_methods;
+    SSAForm ssa;
+    FlowGraph flow;
+    vector<vector<int>> children;
+    map<string, int> defs, uses;
+    map<string, string> values;  // Computation -> variable or constant holding it
+    map<string, string> memory;  // Likewise for loads, as field + "\n" + computation
+    map<int, string> same_as;    // Definition -> value it copies
+    map<string, string> boxed;   // Value of a boxed Int -> what was boxed
+    map<string, string> held;    // Variable standing for a value -> that value
+
+    /* Can this stand for its value wherever its definition dominates? */
+    bool holds_value(const string &operand) {
+        return !IRInstr::is_var(operand) || defs[operand] <= 1;
+    }
+
+    string value_of(const string &operand, int def) {
+        if (!IRInstr::is_var(operand)) { return operand; }
+        return same_as.count(def) != 0 ? same_as[def] : "#" + to_string(def);
+    }
+
+    /* Value of the n-th operand of i */
+    string operand_value(const IRInstr &i, const vector<int> &reaching, int n) {
+        int u = 0;
+        for (int a = 0; a < n; a++) {
+            if (IRInstr::is_var(i.args[a])) { u++; }
+        }
+        return value_of(i.args[n], IRInstr::is_var(i.args[n]) ? reaching[u] : -1);
+    }
+
+    string key(const IRInstr &i, const vector<int> &reaching) {
+        vector<string> operands;
+        int u = 0;
+        for (const string &a: i.args) {
+            operands.push_back(IRInstr::is_var(a) ? value_of(a, reaching[u++]) : a);
+        }
+        if (i.op == IR_PRIM && (i.name == "+" || i.name == "*" || i.name == "==")) {
+            sort(operands.begin(), operands.end());
+        }
+        string k = to_string(i.op) + " " + i.name + " " + i.cast;
+        for (const string &o: operands) { k += " " + o; }
+        return k;
+    }
+
+    /* Turn i into a copy of holder, which has its value */
+    void replace(IRInstr &i, const string &holder, int def) {
+        IRInstr copy(IR_MOVE);
+        copy.dest = i.dest;
+        copy.args = {holder};
+        i = copy;
+        replaced++;
+        if (def >= 0) { same_as[def] = held.count(holder) != 0 ? held[holder] : holder; }
+    }
+
+    void forget_field(const string &field) {
+        for (auto m = memory.begin(); m != memory.end(); ) {
+            string f = m->first.substr(0, m->first.find('\n'));
+            if (f == field || f == "*") {
+                m = memory.erase(m);
+            } else {
+                ++m;
+            }
+        }
+    }
+
+    void visit(int b) {
+        map<string, string> outer_memory = memory;
+        if (flow.preds[b].size() != 1) { memory.clear(); }
+        vector<string> added;
+        vector<IRInstr> &code = fn.blocks[b].code;
+        for (int k = 0; k < code.size(); k++) {
+            IRInstr &i = code[k];
+            const vector<int> &reaching = ssa.use_defs[b][k];
+            if (i.op == IR_SETFIELD) {
+                forget_field(i.name);
+                if (holds_value(i.args[1])) {
+                    IRInstr load(IR_GETFIELD);
+                    load.name = i.name;
+                    load.args = {i.args[0]};
+                    memory[i.name + "\n" + key(load, reaching)] = i.args[1];
+                    held[i.args[1]] = operand_value(i, reaching, 1);
+                }
+                continue;
+            }
+            if (i.op == IR_DISPATCH || i.op == IR_NEW
+                    || (i.op == IR_CALL && !i.is_pure(pure_methods) && output_builtins.count(i.name) == 0)) {
+                memory.clear();
+                continue;
+            }
+            int def = ssa.instr_def[b][k];
+            if (i.op == IR_MOVE) {
+                if (i.cast == "" && def >= 0 && holds_value(i.args[0])) {
+                    same_as[def] = operand_value(i, reaching, 0);
+                }
+                continue;
+            }
+            if (!i.is_pure(pure_methods)) { continue; }
+            string source = i.op == IR_UNBOX ? operand_value(i, reaching, 0) : "";
+            if (i.op == IR_UNBOX && boxed.count(source) != 0) {
+                replace(i, boxed[source], def);
+                continue;
+            }
+            bool reads_fields = i.op == IR_GETFIELD || (i.op == IR_CALL && pure_methods.count(i.name) != 0);
+            map<string, string> &known = reads_fields ? memory : values;
+            string computed = key(i, reaching);
+            if (reads_fields) { computed = (i.op == IR_GETFIELD ? i.name : "*") + "\n" + computed; }
+            if (known.count(computed) != 0) {
+                replace(i, known[computed], def);
+                continue;
+            }
+            if (IRInstr::is_var(i.dest) && defs[i.dest] == 1) {
+                known[computed] = i.dest;
+                held[i.dest] = value_of(i.dest, def);
+                if (!reads_fields) { added.push_back(computed); }
+                if (i.op == IR_BOX && i.name == "Int" && holds_value(i.args[0])) {
+                    boxed[held[i.dest]] = i.args[0];
+                    held[i.args[0]] = operand_value(i, reaching, 0);
+                }
+            }
+        }
+        for (int c: children[b]) { visit(c); }
+        for (const string &k: added) { values.erase(k); }
+        memory = outer_memory;
+    }
+};
+
+int IRFunction::number_values(const set<string> &pure_methods) {
+    for (const IRBlock &b: blocks) {
+        for (const IRInstr &i: b.code) {
+            if (i.op == IR_C) { return 0; }  // Could do anything
+        }
+    }
+    ValueNumbering numbering(*this, pure_methods);
+    return numbering.replaced;
+}
+
+/* Share C locals among temporaries that are never live at the same
+ * time.  Each C type has its own pool of slots; a temporary takes the
+ * first slot of its type holding nothing it interferes with, that is,
+ * nothing live where it is assigned.
+ */
+int IRFunction::reuse_temps() {
+    map<string, string> ctype;
+    vector<string> temps;
+    for (const IRLocal &l: locals) {
+        if (IRInstr::is_temp(l.name)) {
+            ctype[l.name] = l.ctype;
+            temps.push_back(l.name);
+        }
+    }
+    if (temps.empty()) { return 0; }
+    map<string, int> id;
+    for (int t = 0; t < temps.size(); t++) { id[temps[t]] = t; }
+
+    // Live temporaries at the end of each block, by backward dataflow
+    int n = blocks.size();
+    map<string, int> index = block_index();
+    vector<vector<int>> succ(n);
+    vector<set<int>> gen(n), kill(n), live_in(n), live_out(n);
+    for (int b = 0; b < n; b++) {
+        succ[b] = successors(b, index);
+        for (int k = blocks[b].code.size() - 1; k >= 0; k--) {
+            const IRInstr &i = blocks[b].code[k];
+            if (id.count(i.dest) != 0) {
+                gen[b].erase(id[i.dest]);
+                kill[b].insert(id[i.dest]);
+            }
+            for (const string &u: i.uses()) {
+                if (id.count(u) != 0) { gen[b].insert(id[u]); }
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = n - 1; b >= 0; b--) {
+            set<int> out;
+            for (int s: succ[b]) { out.insert(live_in[s].begin(), live_in[s].end()); }
+            set<int> in = gen[b];
+            for (int t: out) {
+                if (kill[b].count(t) == 0) { in.insert(t); }
+            }
+            if (in != live_in[b] || out != live_out[b]) {
+                live_in[b] = in;
+                live_out[b] = out;
+                changed = true;
+            }
+        }
+    }
+
+    // A temporary interferes with whatever is live where it is assigned
+    vector<set<int>> interferes(temps.size());
+    for (int b = 0; b < n; b++) {
+        set<int> live = live_out[b];
+        for (int k = blocks[b].code.size() - 1; k >= 0; k--) {
+            const IRInstr &i = blocks[b].code[k];
+            if (id.count(i.dest) != 0) {
+                int d = id[i.dest];
+                for (int t: live) {
+                    if (t == d) { continue; }
+                    interferes[d].insert(t);
+                    interferes[t].insert(d);
+                }
+                live.erase(d);
+            }
+            for (const string &u: i.uses()) {
+                if (id.count(u) != 0) { live.insert(id[u]); }
+            }
+        }
+    }
+
+    map<string, vector<vector<int>>> slots;  // C type -> temporaries in each slot
+    map<string, string> renamed;
+    for (int t = 0; t < temps.size(); t++) {
+        // Read before it is written: it needs its own initialized local
+        if (live_in[0].count(t) != 0) { continue; }
+        vector<vector<int>> &pool = slots[ctype[temps[t]]];
+        int chosen = -1;
+        for (int s = 0; s < pool.size() && chosen < 0; s++) {
+            bool free = true;
+            for (int other: pool[s]) {
+                if (interferes[t].count(other) != 0) { free = false; break; }
+            }
+            if (free) { chosen = s; }
+        }
+        if (chosen < 0) {
+            pool.push_back(vector<int>());
+            chosen = pool.size() - 1;
+        }
+        pool[chosen].push_back(t);
+        renamed[temps[t]] = temps[pool[chosen][0]];
+    }
+    int merged = 0;
+    for (auto &r: renamed) {
+        if (r.first != r.second) { merged++; }
+    }
+    for (IRBlock &b: blocks) {
+        vector<IRInstr> kept;
+        for (IRInstr i: b.code) {
+            if (renamed.count(i.dest) != 0) { i.dest = renamed[i.dest]; }
+            for (string &a: i.args) {
+                if (renamed.count(a) != 0) { a = renamed[a]; }
+            }
+            // A copy between temporaries now sharing a local is gone
+            if (i.op == IR_MOVE && i.cast == "" && i.dest == i.args[0]) { continue; }
+            kept.push_back(i);
+        }
+        b.code = kept;
+    }
+    return merged;
+}
+
+/* Hoist the loop-invariant computations of the loop headed by the block
+ * with the given label into a new preheader block, which is entered in
+ * place of the header from outside the loop.
+ */
+int IRFunction::hoist_from_loop(const string &header_label, const set<string> &pure_methods) {
+    FlowGraph flow(*this);
+    map<string, int> index = block_index();
+    int header = index[header_label];
+    set<int> body = flow.loop_body(header);
+
+    map<string, int> defs, uses;
+    count_refs(blocks, defs, uses);
+    set<string> assigned;       // Variables assigned in the loop
+    set<string> stored;         // Fields assigned in the loop
+    bool unknown_calls = false; // Calls that might assign any field
+    for (int b: body) {
+        for (const IRInstr &i: blocks[b].code) {
+            if (i.dest != "") { assigned.insert(i.dest); }
+            if (i.op == IR_SETFIELD) { stored.insert(i.name); }
+            if (i.op == IR_DISPATCH || i.op == IR_NEW || i.op == IR_C
+                    || (i.op == IR_CALL && !i.is_pure(pure_methods) && output_builtins.count(i.name) == 0)) {
+                unknown_calls = true;
+            }
+        }
+    }
+
+    // An instruction is invariant if it can be moved and its operands
+    // are constants, are not assigned in the loop, or are the results
+    // of invariant instructions.  Each value is computed once by a
+    // single definition, so it is the same before the loop as in it.
+    set<string> invariant;
+    map<int, set<int>> hoisted;  // Block -> indices of its instructions
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b: body) {
+            for (int k = 0; k < blocks[b].code.size(); k++) {
+                const IRInstr &i = blocks[b].code[k];
+                if (!IRInstr::is_temp(i.dest) || defs[i.dest] != 1 || invariant.count(i.dest) != 0) {
+                    continue;
+                }
+                // Fresh objects (and constructors) must stay fresh each time
+                if (!i.is_pure(pure_methods) || i.op == IR_NEW) { continue; }
+                bool reads_fields = i.op == IR_GETFIELD
+                    || (i.op == IR_CALL && pure_methods.count(i.name) != 0);
+                if (reads_fields && (unknown_calls || (i.op == IR_GETFIELD ? stored.count(i.name) != 0 : !stored.empty()))) {
+                    continue;
+                }
+                bool operands_invariant = true;
+                for (const string &u: i.uses()) {
+                    if (assigned.count(u) != 0 && invariant.count(u) == 0) {
+                        operands_invariant = false;
+                    }
+                }
+                if (operands_invariant) {
+                    invariant.insert(i.dest);
+                    hoisted[b].insert(k);
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (invariant.empty()) { return 0; }
+
+    // Definitions come before uses in block order, so they can be
+    // hoisted in that order.
+    IRBlock preheader;
+    preheader.label = header_label + "_pre";
+    for (auto &h: hoisted) {
+        vector<IRInstr> kept;
+        vector<IRInstr> &code = blocks[h.first].code;
+        for (int k = 0; k < code.size(); k++) {
+            if (h.second.count(k) != 0) {
+                preheader.code.push_back(code[k]);
+            } else {
+                kept.push_back(code[k]);
+            }
+        }
+        code = kept;
+    }
+    for (int p: flow.preds[header]) {
+        if (body.count(p) != 0) { continue; }
+        for (IRInstr &i: blocks[p].code) {
+            if (i.op == IR_JUMP && i.label == header_label) { i.label = preheader.label; }
+            if (i.op == IR_BRANCH || i.op == IR_SWITCH) {
+                for (string &t: i.targets) {
+                    if (t == header_label) { t = preheader.label; }
+                }
+            }
+        }
+    }
+    // The preheader falls through to the header, so anything in the
+    // loop that fell through into the header must now jump.
+    int before = header - 1;
+    if (before >= 0 && body.count(before) != 0) {
+        vector<int> succ = successors(before, index);
+        if (find(succ.begin(), succ.end(), header) != succ.end()
+                && (blocks[before].code.empty() || !blocks[before].code.back().is_terminator())) {
+            IRInstr jump(IR_JUMP);
+            jump.label = header_label;
+            blocks[before].code.push_back(jump);
+        }
+    }
+    blocks.insert(blocks.begin() + header, preheader);
+    return invariant.size();
+}
+
+/* Loop-invariant code motion, innermost loops first so that what they
+ * hoist can move on out of the loops around them
+ */
+int IRFunction::hoist_invariants(const set<string> &pure_methods) {
+    FlowGraph flow(*this);
+    vector<pair<int, string>> loops;  // Size and header label
+    for (int h = 0; h < blocks.size(); h++) {
+        for (int p: flow.preds[h]) {
+            if (flow.dominates(h, p)) {
+                loops.push_back({flow.loop_body(h).size(), blocks[h].label});
+                break;
+            }
+        }
+    }
+    sort(loops.begin(), loops.end());
+    int hoisted = 0;
+    for (auto &loop: loops) {
+        if (loop.second == "") { continue; }  // Headers are branch targets
+        hoisted += hoist_from_loop(loop.second, pure_methods);
+    }
+    return hoisted;
+}
+
+/* Does this function (a method) always return, leaving every object as
+ * it was and creating none but built-in values?  Then calls to it can
+ * be moved or removed like those of the pure built-in methods.
+ */
+bool IRFunction::is_pure_method(const set<string> &pure_methods) const {
+    if (name.find("_method_") == string::npos) { return false; }
+    FlowGraph flow(*this);
+    for (int b = 0; b < blocks.size(); b++) {
+        for (int s: flow.succ[b]) {
+            if (flow.dominates(s, b)) { return false; }  // A loop might not end
+        }
+        for (const IRInstr &i: blocks[b].code) {
+            if (i.op == IR_SETFIELD || i.op == IR_NEW || i.op == IR_ALLOC) { return false; }
+            if (i.op == IR_RETURN || i.op == IR_JUMP || i.op == IR_BRANCH || i.op == IR_SWITCH) { continue; }
+            if (!i.is_pure(pure_methods)) { return false; }
+        }
+    }
+    return true;
+}
+
+int IRFunction::remove_unused_locals() {
+    set<string> used;
+    for (const IRBlock &b: blocks) {
+        for (const IRInstr &i: b.code) {
+            used.insert(i.dest);
+            used.insert(i.args.begin(), i.args.end());
+            if (i.op == IR_C) { return 0; }
+        }
+    }
+    vector<IRLocal> kept;
+    for (const IRLocal &l: locals) {
+        if (used.count(l.name) != 0) { kept.push_back(l); }
+    }
+    int removed = locals.size() - kept.size();
+    locals = kept;
+    return removed;
+}
+
+void IRFunction::optimize(IROptions &opts) {
+    int instrs = size();
+    int nlocals = locals.size();
+    int unreachable = remove_unreachable();
+    int propagated = propagate_copies();
+    int redundant = number_values(opts.pure_methods);
+    if (redundant > 0) { propagated += propagate_copies(); }
+    int coalesced = coalesce_copies();
+    int dead = eliminate_dead_code(opts.pure_methods);
+    int invariant = hoist_invariants(opts.pure_methods);
+    int merged = reuse_temps();
+    int unused = remove_unused_locals();
+    if (opts.report != nullptr) {
+        *opts.report << name << ": removed " << unreachable << " unreachable, "
+                     << coalesced << " coalesced and " << dead << " dead of "
+                     << instrs << " instructions; replaced " << redundant
+                     << " redundant computations; forwarded " << propagated
+                     << " copies; hoisted " << invariant << " out of loops; removed "
+                     << unused << " of " << nlocals << " locals, " << merged
+                     << " by sharing" << endl;
+    }
+    if (is_pure_method(opts.pure_methods)) { opts.pure_methods.insert(name); }
+}
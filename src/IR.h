@@ -0,0 +1,462 @@
+//
+// Three-address intermediate form for the body of one generated C
+// function.  Code generation builds it from the typed AST (through the
+// emit_* methods of CodegenContext) and print_c lowers it to C text, so
+// passes that rewrite the generated code have a single place to work.
+//
+// Operands are C names: temporaries (tmp__N), source variables (var_x),
+// the receiver (this), or constants (lit_true, (&lit_int_3), 42).  Only
+// the first three are values that can be defined and used; see is_var.
+//
+
+#ifndef AST_IR_H
+#define AST_IR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using namespace std;
+
+enum IROp {
+    IR_MOVE,      // dest = args[0], converted to obj_<cast> if given
+    IR_PRIM,      // dest = args[0] name args[1] on C ints
+    IR_NOT,       // dest = !args[0]
+    IR_BOX,       // dest = boxed Int or Boolean (name) of args[0]
+    IR_UNBOX,     // dest = args[0]->value
+    IR_GETFIELD,  // dest = args[0]->name
+    IR_SETFIELD,  // args[0]->name = args[1]
+    IR_CALL,      // dest = name(args), receiver cast to obj_<cast>
+    IR_DISPATCH,  // dest = args[0]->clazz->name(args), with an inline
+                  // cache over the implementations in targets
+    IR_NEW,       // dest = new_<name>(args)
+    IR_ALLOC,     // dest = uninitialized object of class name
+    IR_LABEL,     // start of the block called label
+    IR_JUMP,      // goto label
+    IR_BRANCH,    // if (args[0]) or (args[0] name args[1]),
+                  // goto targets[0], else goto targets[1]
+    IR_SWITCH,    // goto targets[k] for the first k > 0 where args[0]
+                  // equals the constant args[k], or lies in its range
+                  // "low ... high" (a GNU C case range), else goto
+                  // targets[0]
+    IR_RETURN,    // leave the function with args[0]
+    IR_TAILCALL,  // leave the function with the result of name(args), as
+                  // IR_CALL, or as IR_DISPATCH if there are targets, in
+                  // constant stack (see print_tail_transfer)
+    IR_C          // verbatim C text in name, opaque to analysis
+};
+
+struct IRInstr {
+    IROp op;
+    string dest;
+    string name;
+    vector<string> args;
+    string cast;
+    vector<string> targets;
+    string label;
+    string note;     // Comment carried into the C
+
+    IRInstr(IROp o) : op{o} {}
+
+    bool is_terminator() const {
+        return op == IR_JUMP || op == IR_BRANCH || op == IR_SWITCH || op == IR_RETURN || op == IR_TAILCALL;
+    }
+
+    /* Operands that are variables rather than constants */
+    vector<string> uses() const {
+        vector<string> vars;
+        for (const string &a: args) {
+            if (is_var(a)) { vars.push_back(a); }
+        }
+        return vars;
+    }
+
+    static bool is_var(const string &operand) {
+        return operand == "this" || operand.compare(0, 5, "tmp__") == 0
+            || operand.compare(0, 4, "var_") == 0;
+    }
+
+    static bool is_temp(const string &operand) {
+        return operand.compare(0, 5, "tmp__") == 0;
+    }
+
+    /* Can this be deleted if its result is not used, or computed
+     * earlier?  Calls are, to built-in methods that have no effects and
+     * to the user methods in pure_methods.  (IR.cxx)
+     */
+    bool is_pure(const set<string> &pure_methods) const;
+};
+
+struct IRBlock {
+    string label;    // Empty for a block entered only by fall-through
+    vector<IRInstr> code;
+};
+
+/* How each function is optimized, and what is reported on the way.
+ * Shared by every CodegenContext derived from the same root.
+ */
+struct IROptions {
+    bool optimize = true;
+    ostream *dump = nullptr;    // --dump-ir: the IR of each function
+    ostream *report = nullptr;  // --report-opt: what each pass removed
+    // Methods optimized so far that have no effects (IRFunction::is_pure_method)
+    set<string> pure_methods;
+    // Methods whose tail calls go through the trampoline (Builtins.h),
+    // compiled as name_body and an entry point name that runs it
+    set<string> trampolined;
+    // Expanding statically bound calls in place, during code generation.
+    // Sizes are counted in AST nodes (ASTNode::size).
+    bool inline_calls = true;
+    int inline_size = 30;     // Largest method body expanded
+    int inline_budget = 200;  // Total expanded into any one function
+    int inline_depth = 3;     // Expansions nested within one another
+    ostream *inline_report = nullptr;  // --report-inlining: each decision
+};
+
+/* A C local of the function: hoisted ahead of the body and, if it
+ * holds an object, registered with the collector.
+ */
+struct IRLocal {
+    string ctype;
+    string name;
+    string init;
+    string comment;
+    bool root;
+};
+
+class IRFunction {
+public:
+    string name;
+    vector<IRLocal> locals;
+    vector<string> params;   // Object parameters, also GC roots
+    vector<string> signature;  // C result and parameter types, for tail calls
+    vector<IRBlock> blocks;
+
+    explicit IRFunction(string fname) : name{fname} { blocks.push_back(IRBlock()); }
+
+    void declare(string ctype, string local, string init, string comment) {
+        locals.push_back({ctype, local, init, comment, init == "NULL"});
+    }
+
+    /* Append to the current block.  Labels start a new block, and so
+     * does whatever follows a jump, branch, or return.
+     */
+    void append(const IRInstr &instr) {
+        if (instr.op == IR_LABEL) {
+            IRBlock b;
+            b.label = instr.label;
+            blocks.push_back(b);
+            return;
+        }
+        IRBlock &cur = blocks.back();
+        if (!cur.code.empty() && cur.code.back().is_terminator()) {
+            blocks.push_back(IRBlock());
+        }
+        blocks.back().code.push_back(instr);
+    }
+
+    int size() const {
+        int n = 0;
+        for (const IRBlock &b: blocks) { n += b.code.size(); }
+        return n;
+    }
+
+    /* Index of the block with each label */
+    map<string, int> block_index() const {
+        map<string, int> index;
+        for (int i = 0; i < blocks.size(); i++) {
+            if (blocks[i].label != "") { index[blocks[i].label] = i; }
+        }
+        return index;
+    }
+
+    /* Blocks that control can reach directly from block i */
+    vector<int> successors(int i, const map<string, int> &index) const {
+        vector<int> succ;
+        const vector<IRInstr> &code = blocks[i].code;
+        if (!code.empty() && code.back().op == IR_JUMP) {
+            succ.push_back(index.at(code.back().label));
+        } else if (!code.empty() && code.back().op == IR_BRANCH) {
+            succ.push_back(index.at(code.back().targets[0]));
+            succ.push_back(index.at(code.back().targets[1]));
+        } else if (!code.empty() && code.back().op == IR_SWITCH) {
+            for (const string &t: code.back().targets) {
+                int s = index.at(t);
+                if (find(succ.begin(), succ.end(), s) == succ.end()) { succ.push_back(s); }
+            }
+        } else if (code.empty() || !code.back().is_terminator()) {
+            if (i + 1 < blocks.size()) { succ.push_back(i + 1); }
+        }
+        return succ;
+    }
+
+    /* Optimization passes (IR.cxx).  Each returns how much it changed:
+     * instructions removed, operands replaced, or locals merged away.
+     */
+    void optimize(IROptions &opts);
+    int remove_unreachable();
+    int propagate_copies();
+    int coalesce_copies();
+    int number_values(const set<string> &pure_methods);
+    int eliminate_dead_code(const set<string> &pure_methods);
+    int hoist_invariants(const set<string> &pure_methods);
+    int hoist_from_loop(const string &header_label, const set<string> &pure_methods);
+    int reuse_temps();
+    bool is_pure_method(const set<string> &pure_methods) const;
+    int remove_unused_locals();
+
+    /* Label of the start of the body, for jumping back to (a self tail
+     * call).  The first block is labelled the first time, behind a new
+     * empty block, so that where the function is entered still has no
+     * predecessors.
+     */
+    string entry_label() {
+        if (block_index().count("entry") == 0) {
+            blocks[0].label = "entry";
+            blocks.insert(blocks.begin(), IRBlock());
+        }
+        return "entry";
+    }
+
+    /* C expression boxing an unboxed value of the given type */
+    static string box_expr(string type, string prim) {
+        if (type == "Boolean") { return "(" + prim + " ? lit_true : lit_false)"; }
+        return "int_literal(" + prim + ")";
+    }
+
+    /* Lower to C: declarations, the GC frame, then the blocks.  Tail
+     * calls to the methods in trampolined go to their bodies.
+     */
+    void print_c(ostream &out, const set<string> &trampolined) const {
+        for (const IRLocal &l: locals) {
+            out << l.ctype << " " << l.name << " = " << l.init << ";" << l.comment << endl;
+        }
+        for (const IRBlock &b: blocks) {
+            for (const IRInstr &i: b.code) {
+                if ((i.op == IR_DISPATCH || i.op == IR_TAILCALL) && i.targets.size() > 0) {
+                    out << "QUACK_IC_SITE(" << i.label << ", \"" << i.note << "\");" << endl;
+                }
+            }
+        }
+        vector<string> roots;
+        for (const string &p: params) { roots.push_back(p); }
+        for (const IRLocal &l: locals) {
+            if (l.root) { roots.push_back(l.name); }
+        }
+        if (roots.empty()) {
+            out << "GC_PUSH_FRAME(NULL, 0);" << endl;
+        } else {
+            out << "void **gc_slots[] = { ";
+            string sep = "";
+            for (const string &r: roots) {
+                out << sep << "(void **) &" << r;
+                sep = ", ";
+            }
+            out << " };" << endl;
+            out << "GC_PUSH_FRAME(gc_slots, " << roots.size() << ");" << endl;
+        }
+        for (const IRBlock &b: blocks) {
+            if (b.label != "") { out << b.label << ": ;" << endl; }
+            for (const IRInstr &i: b.code) { print_instr(out, i, trampolined); }
+        }
+    }
+
+    /* Readable listing for --dump-ir */
+    void dump(ostream &out) const {
+        out << "function " << name << " (" << blocks.size() << " blocks, "
+            << size() << " instructions)" << endl;
+        for (const IRLocal &l: locals) {
+            out << "  local " << l.ctype << " " << l.name << endl;
+        }
+        for (int n = 0; n < blocks.size(); n++) {
+            const IRBlock &b = blocks[n];
+            out << "  B" << n;
+            if (b.label != "") { out << " " << b.label; }
+            out << ":" << endl;
+            for (const IRInstr &i: b.code) { out << "    " << dump_instr(i) << endl; }
+        }
+    }
+
+    static string dump_instr(const IRInstr &i) {
+        static const char *names[] = {
+            "move", "prim", "not", "box", "unbox", "getfield", "setfield", "call",
+            "dispatch", "new", "alloc", "label", "jump", "branch", "switch", "return", "tailcall", "c"
+        };
+        string s = i.dest == "" ? "" : i.dest + " = ";
+        s += names[i.op];
+        if (i.name != "" && i.op != IR_C) { s += " " + i.name; }
+        if (i.cast != "") { s += " (" + i.cast + ")"; }
+        for (const string &a: i.args) { s += " " + a; }
+        if (i.label != "") { s += " -> " + i.label; }
+        for (const string &t: i.targets) { s += " [" + t + "]"; }
+        if (i.op == IR_C) { s += " " + i.name; }
+        return s;
+    }
+
+private:
+    static string call_args(const IRInstr &i, string receiver_cast) {
+        string s;
+        for (int a = 0; a < i.args.size(); a++) {
+            if (a > 0) { s += ", "; }
+            if (a == 0 && receiver_cast != "") { s += "(obj_" + receiver_cast + ") "; }
+            s += i.args[a];
+        }
+        return s;
+    }
+
+    /* Leave the function with the result of callee(args of i), reusing
+     * its stack: by a guaranteed tail call where the C compiler has them
+     * and the callee takes as many arguments (all are object pointers,
+     * so the C types are converted to the caller's), or else by
+     * returning the call to the trampoline to make.  An ordinary call
+     * would not do, as the published address of the GC frame keeps gcc
+     * from reusing the stack even at -O2.
+     */
+    void print_tail_transfer(ostream &out, const IRInstr &i, string callee) const {
+        string result = signature[0];
+        bool same_arity = i.args.size() == signature.size() - 1;
+        if (same_arity) {
+            string params, actuals;
+            for (int a = 0; a < i.args.size(); a++) {
+                string sep = a == 0 ? "" : ", ";
+                params += sep + signature[a + 1];
+                actuals += sep + "(" + signature[a + 1] + ") " + i.args[a];
+            }
+            out << "#ifdef QUACK_MUSTTAIL" << endl;
+            out << "QUACK_MUSTTAIL return ((" << result << " (*)(" << params << ")) "
+                << callee << ")(" << actuals << ");" << endl;
+            out << "#else" << endl;
+        }
+        out << "quack_tail.fn = (void (*)(void)) " << callee << ";" << endl;
+        out << "quack_tail.nargs = " << i.args.size() << ";" << endl;
+        for (int a = 0; a < i.args.size(); a++) {
+            out << "quack_tail.args[" << a << "] = (obj_Obj) " << i.args[a] << ";" << endl;
+        }
+        out << "return (" << result << ") QUACK_TAIL_PENDING;" << endl;
+        if (same_arity) { out << "#endif" << endl; }
+    }
+
+    /* Where a tail call to callee enters it */
+    static string tail_entry(const string &callee, const set<string> &trampolined) {
+        return trampolined.count(callee) == 0 ? callee : callee + "_body";
+    }
+
+    void print_instr(ostream &out, const IRInstr &i, const set<string> &trampolined) const {
+        string note = i.note == "" ? "" : " // " + i.note;
+        switch (i.op) {
+            case IR_MOVE:
+                out << i.dest << " = " << (i.cast == "" ? "" : "(obj_" + i.cast + ") ")
+                    << i.args[0] << ";" << note << endl;
+                break;
+            case IR_PRIM:
+                out << i.dest << " = " << i.args[0] << " " << i.name << " " << i.args[1] << ";" << endl;
+                break;
+            case IR_NOT:
+                out << i.dest << " = !" << i.args[0] << ";" << endl;
+                break;
+            case IR_BOX:
+                out << i.dest << " = " << box_expr(i.name, i.args[0]) << ";" << note << endl;
+                break;
+            case IR_UNBOX:
+                out << i.dest << " = " << i.args[0] << "->value;" << endl;
+                break;
+            case IR_GETFIELD:
+                out << i.dest << " = " << i.args[0] << "->" << i.name << ";" << note << endl;
+                break;
+            case IR_SETFIELD:
+                out << i.args[0] << "->" << i.name << " = " << i.args[1] << ";" << endl;
+                break;
+            case IR_CALL:
+                out << i.dest << " = " << i.name << "(" << call_args(i, i.cast) << ");" << endl;
+                break;
+            case IR_DISPATCH: {
+                string slot = i.args[0] + "->clazz->" + i.name;
+                string actuals = call_args(i, "");
+                if (i.targets.empty()) {
+                    out << i.dest << " = " << slot << "(" << actuals << ");" << endl;
+                    break;
+                }
+                // The candidates are known from the hierarchy, so the cache
+                // is filled at compile time: compare the method table entry
+                // with each and call it directly (which gcc can inline) on a hit.
+                string sep = "if";
+                for (const string &impl: i.targets) {
+                    string fn = impl + "_method_" + i.name;
+                    out << sep << " (QUACK_SAME_FN(" << slot << ", " << fn << ")) {" << endl;
+                    out << "QUACK_IC_HIT(" << i.label << ");" << endl;
+                    out << i.dest << " = " << fn << "(" << call_args(i, impl) << ");" << endl;
+                    sep = "} else if";
+                }
+                out << "} else {" << endl;
+                out << "QUACK_IC_MISS(" << i.label << ");" << endl;
+                out << i.dest << " = " << slot << "(" << actuals << ");" << endl;
+                out << "}" << endl;
+                break;
+            }
+            case IR_NEW:
+                out << i.dest << " = new_" << i.name << "(" << call_args(i, "") << "); // Construct" << endl;
+                break;
+            case IR_ALLOC:
+                out << i.dest << " = (obj_" << i.name << ") gc_alloc(&gc_type_" << i.name << ");" << endl;
+                out << "COUNT_ALLOC(objs);" << endl;
+                break;
+            case IR_LABEL:
+                out << i.label << ": ;" << endl;
+                break;
+            case IR_JUMP:
+                out << "goto " << i.label << ";" << note << endl;
+                break;
+            case IR_BRANCH:
+                if (i.args.size() == 1) {
+                    out << "if (" << i.args[0] << ") goto " << i.targets[0] << ";" << endl;
+                } else {
+                    out << "if (" << i.args[0] << " " << i.name << " " << i.args[1]
+                        << ") goto " << i.targets[0] << ";" << endl;
+                }
+                out << "goto " << i.targets[1] << ";" << endl;
+                break;
+            case IR_SWITCH:
+                out << "switch (" << i.args[0] << ") {" << endl;
+                for (int k = 1; k < i.args.size(); k++) {
+                    out << "case " << i.args[k] << ": goto " << i.targets[k] << ";" << endl;
+                }
+                out << "default: goto " << i.targets[0] << ";" << endl;
+                out << "}" << endl;
+                break;
+            case IR_RETURN:
+                out << "GC_POP_FRAME();" << endl;
+                out << "return " << i.args[0] << ";" << endl;
+                break;
+            case IR_TAILCALL: {
+                out << "GC_POP_FRAME();" << endl;
+                if (i.targets.empty()) {
+                    print_tail_transfer(out, i, tail_entry(i.name, trampolined));
+                    break;
+                }
+                // As IR_DISPATCH, but each candidate is entered at its body
+                string slot = i.args[0] + "->clazz->" + i.name;
+                string sep = "if";
+                for (const string &impl: i.targets) {
+                    string fn = impl + "_method_" + i.name;
+                    out << sep << " (QUACK_SAME_FN(" << slot << ", " << fn << ")) {" << endl;
+                    out << "QUACK_IC_HIT(" << i.label << ");" << endl;
+                    print_tail_transfer(out, i, tail_entry(fn, trampolined));
+                    sep = "} else if";
+                }
+                out << "} else {" << endl;
+                out << "QUACK_IC_MISS(" << i.label << ");" << endl;
+                print_tail_transfer(out, i, slot);
+                out << "}" << endl;
+                break;
+            }
+            case IR_C:
+                out << i.name << endl;
+                break;
+        }
+    }
+};
+
+#endif //AST_IR_H
@@ -0,0 +1,81 @@
+//
+// Interned names.  Each distinct class, method, or variable name gets a
+// small integer (its Symbol) the first time it is seen, so that the
+// semantic checks can keep names in integer sets and tables indexed by
+// them, and compare names as ints rather than strings.
+//
+
+#ifndef AST_SYMBOLS_H
+#define AST_SYMBOLS_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+
+typedef int Symbol;
+
+class Symbols {
+public:
+    Symbol intern(const string &name) {
+        auto found = ids_.find(name);
+        if (found != ids_.end()) { return found->second; }
+        Symbol s = names_.size();
+        ids_[name] = s;
+        names_.push_back(name);
+        return s;
+    }
+
+    /* The symbol of name, or -1 if it has never been interned */
+    Symbol lookup(const string &name) const {
+        auto found = ids_.find(name);
+        return found == ids_.end() ? -1 : found->second;
+    }
+
+    const string &name(Symbol s) const { return names_[s]; }
+    int size() const { return names_.size(); }
+
+private:
+    unordered_map<string, Symbol> ids_;
+    vector<string> names_;
+};
+
+/* The table shared by the parser, the AST, and Semantics */
+inline Symbols &symbols() {
+    static Symbols table;
+    return table;
+}
+
+/* The names defined at some point in a method, for the instantiation
+ * check: those defined in the method so far, in order, on top of the
+ * names defined everywhere (classes and methods), which are shared
+ * rather than copied into every method's set.
+ */
+class Names {
+public:
+    explicit Names(const Names *everywhere = nullptr) : everywhere_{everywhere} {}
+
+    bool contains(Symbol s) const {
+        return s >= 0 && (own_.count(s) != 0 || (everywhere_ != nullptr && everywhere_->contains(s)));
+    }
+    bool contains(const string &name) const { return contains(symbols().lookup(name)); }
+
+    void insert(Symbol s) {
+        if (contains(s)) { return; }
+        own_.insert(s);
+        order_.push_back(s);
+    }
+    void insert(const string &name) { insert(symbols().intern(name)); }
+
+    /* Those defined in the method, in the order they were defined */
+    const vector<Symbol> &own() const { return order_; }
+
+private:
+    const Names *everywhere_;
+    set<Symbol> own_;
+    vector<Symbol> order_;
+};
+
+#endif //AST_SYMBOLS_H
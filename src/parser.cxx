@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <unistd.h>  // getopt is here
+#include <getopt.h>  // and getopt_long here
 
 using namespace std;
 
@@ -45,8 +46,10 @@ private:
     AST::Program *root;
 };
 
-void generate_code(AST::Program *root, Semantics *s) {
+void generate_code(AST::Program *root, Semantics *s, bool boxed, IROptions &opts) {
     CodegenContext ctx(std::cout);
+    ctx.unbox_prims = !boxed;
+    *ctx.ir_opts = opts;
     // Prologue
     
     // Body of generated code
@@ -61,13 +64,43 @@ int main(int argc, char **argv) {
     char c;
     FILE *f;
     int index;
-    int debug; // 0 = no debugging, 1 = full tracing
+    int debug = 0; // 0 = no debugging, 1 = full tracing
+    bool boxed = false; // -b: box every Int and Boolean, as before typed lowering
+    IROptions ir_opts;
+    bool report_types = false;
+    static struct option long_options[] = {
+        {"dump-ir", no_argument, 0, 'i'},    // List each function's IR on stderr
+        {"report-opt", no_argument, 0, 'r'}, // Report what optimization removed
+        {"no-opt", no_argument, 0, 'n'},     // Emit the IR as built
+        {"report-inlining", no_argument, 0, 'l'}, // Report each call considered for inlining
+        {"report-types", no_argument, 0, 'y'}, // Report how often type inference ran each method
+        {0, 0, 0, 0}
+    };
 
-    while ((c = getopt(argc, argv, "t")) != -1) {
+    while ((c = getopt_long(argc, argv, "tb", long_options, nullptr)) != -1) {
         if (c == 't') {
             std::cerr <<  "Debugging mode\n";
             debug = 1;
         }
+        if (c == 'b') {
+            boxed = true;
+        }
+        if (c == 'i') {
+            ir_opts.dump = &std::cerr;
+        }
+        if (c == 'r') {
+            ir_opts.report = &std::cerr;
+        }
+        if (c == 'n') {
+            ir_opts.optimize = false;
+            ir_opts.inline_calls = false;
+        }
+        if (c == 'l') {
+            ir_opts.inline_report = &std::cerr;
+        }
+        if (c == 'y') {
+            report_types = true;
+        }
     }
 
     for (index = optind; index < argc; ++index) {
@@ -82,8 +115,11 @@ int main(int argc, char **argv) {
             //AST::AST_print_context context;
             //root->json(std::cout, context);
             Semantics semantics(root);
+            if (report_types) semantics.report = &std::cerr;
             semantics.check_semantics();
-            generate_code(root, &semantics);
+            EvalContext consts;
+            root->eval(consts); // Fold constants
+            generate_code(root, &semantics, boxed, ir_opts);
         } else {
             std::cerr << "No tree produced." << std::endl;
         }
@@ -0,0 +1,1474 @@
+// A Bison parser, made by GNU Bison 3.8.2.
+
+// Skeleton implementation for Bison LALR(1) parsers in C++
+
+// Copyright (C) 2002-2015, 2018-2021 Free Software Foundation, Inc.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// As a special exception, you may create a larger work that contains
+// part or all of the Bison parser skeleton and distribute that work
+// under terms of your choice, so long as that work isn't itself a
+// parser generator using the skeleton or a modified version thereof
+// as a parser skeleton.  Alternatively, if you modify or redistribute
+// the parser skeleton itself, you may (at your option) remove this
+// special exception, which will cause the skeleton and the resulting
+// Bison output files to be licensed under the GNU General Public
+// License without this special exception.
+
+// This special exception was added by the Free Software Foundation in
+// version 2.2 of Bison.
+
+// DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+// especially those whose name start with YY_ or yy_.  They are
+// private implementation details that can be changed or removed.
+
+
+
+
+
+#include "quack.tab.hxx"
+
+
+// Unqualified %code blocks.
+#line 30 "quack.yxx"
+
+    #include "lex.yy.h"
+    #undef yylex
+    #define yylex lexer.yylex  /* Within bison's parse() we should invoke lexer.yylex(), not the global yylex() */
+    void dump(AST::ASTNode* n);
+
+
+#line 54 "quack.tab.cxx"
+
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> // FIXME: INFRINGES ON USER NAME SPACE.
+#   define YY_(msgid) dgettext ("bison-runtime", msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(msgid) msgid
+# endif
+#endif
+
+
+// Whether we are compiled with exception support.
+#ifndef YY_EXCEPTIONS
+# if defined __GNUC__ && !defined __EXCEPTIONS
+#  define YY_EXCEPTIONS 0
+# else
+#  define YY_EXCEPTIONS 1
+# endif
+#endif
+
+#define YYRHSLOC(Rhs, K) ((Rhs)[K].location)
+/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
+   If N is 0, then set CURRENT to the empty location which ends
+   the previous symbol: RHS[0] (always defined).  */
+
+# ifndef YYLLOC_DEFAULT
+#  define YYLLOC_DEFAULT(Current, Rhs, N)                               \
+    do                                                                  \
+      if (N)                                                            \
+        {                                                               \
+          (Current).begin  = YYRHSLOC (Rhs, 1).begin;                   \
+          (Current).end    = YYRHSLOC (Rhs, N).end;                     \
+        }                                                               \
+      else                                                              \
+        {                                                               \
+          (Current).begin = (Current).end = YYRHSLOC (Rhs, 0).end;      \
+        }                                                               \
+    while (false)
+# endif
+
+
+// Enable debugging if requested.
+#if YYDEBUG
+
+// A pseudo ostream that takes yydebug_ into account.
+# define YYCDEBUG if (yydebug_) (*yycdebug_)
+
+# define YY_SYMBOL_PRINT(Title, Symbol)         \
+  do {                                          \
+    if (yydebug_)                               \
+    {                                           \
+      *yycdebug_ << Title << ' ';               \
+      yy_print_ (*yycdebug_, Symbol);           \
+      *yycdebug_ << '\n';                       \
+    }                                           \
+  } while (false)
+
+# define YY_REDUCE_PRINT(Rule)          \
+  do {                                  \
+    if (yydebug_)                       \
+      yy_reduce_print_ (Rule);          \
+  } while (false)
+
+# define YY_STACK_PRINT()               \
+  do {                                  \
+    if (yydebug_)                       \
+      yy_stack_print_ ();                \
+  } while (false)
+
+#else // !YYDEBUG
+
+# define YYCDEBUG if (false) std::cerr
+# define YY_SYMBOL_PRINT(Title, Symbol)  YY_USE (Symbol)
+# define YY_REDUCE_PRINT(Rule)           static_cast<void> (0)
+# define YY_STACK_PRINT()                static_cast<void> (0)
+
+#endif // !YYDEBUG
+
+#define yyerrok         (yyerrstatus_ = 0)
+#define yyclearin       (yyla.clear ())
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYRECOVERING()  (!!yyerrstatus_)
+
+namespace yy {
+#line 146 "quack.tab.cxx"
+
+  /// Build a parser object.
+  parser::parser (yy::Lexer& lexer_yyarg, AST::Program** root_yyarg)
+#if YYDEBUG
+    : yydebug_ (false),
+      yycdebug_ (&std::cerr),
+#else
+    :
+#endif
+      lexer (lexer_yyarg),
+      root (root_yyarg)
+  {}
+
+  parser::~parser ()
+  {}
+
+  parser::syntax_error::~syntax_error () YY_NOEXCEPT YY_NOTHROW
+  {}
+
+  /*---------.
+  | symbol.  |
+  `---------*/
+
+  // basic_symbol.
+  template <typename Base>
+  parser::basic_symbol<Base>::basic_symbol (const basic_symbol& that)
+    : Base (that)
+    , value (that.value)
+    , location (that.location)
+  {}
+
+
+  /// Constructor for valueless symbols.
+  template <typename Base>
+  parser::basic_symbol<Base>::basic_symbol (typename Base::kind_type t, YY_MOVE_REF (location_type) l)
+    : Base (t)
+    , value ()
+    , location (l)
+  {}
+
+  template <typename Base>
+  parser::basic_symbol<Base>::basic_symbol (typename Base::kind_type t, YY_RVREF (value_type) v, YY_RVREF (location_type) l)
+    : Base (t)
+    , value (YY_MOVE (v))
+    , location (YY_MOVE (l))
+  {}
+
+
+  template <typename Base>
+  parser::symbol_kind_type
+  parser::basic_symbol<Base>::type_get () const YY_NOEXCEPT
+  {
+    return this->kind ();
+  }
+
+
+  template <typename Base>
+  bool
+  parser::basic_symbol<Base>::empty () const YY_NOEXCEPT
+  {
+    return this->kind () == symbol_kind::S_YYEMPTY;
+  }
+
+  template <typename Base>
+  void
+  parser::basic_symbol<Base>::move (basic_symbol& s)
+  {
+    super_type::move (s);
+    value = YY_MOVE (s.value);
+    location = YY_MOVE (s.location);
+  }
+
+  // by_kind.
+  parser::by_kind::by_kind () YY_NOEXCEPT
+    : kind_ (symbol_kind::S_YYEMPTY)
+  {}
+
+#if 201103L <= YY_CPLUSPLUS
+  parser::by_kind::by_kind (by_kind&& that) YY_NOEXCEPT
+    : kind_ (that.kind_)
+  {
+    that.clear ();
+  }
+#endif
+
+  parser::by_kind::by_kind (const by_kind& that) YY_NOEXCEPT
+    : kind_ (that.kind_)
+  {}
+
+  parser::by_kind::by_kind (token_kind_type t) YY_NOEXCEPT
+    : kind_ (yytranslate_ (t))
+  {}
+
+
+
+  void
+  parser::by_kind::clear () YY_NOEXCEPT
+  {
+    kind_ = symbol_kind::S_YYEMPTY;
+  }
+
+  void
+  parser::by_kind::move (by_kind& that)
+  {
+    kind_ = that.kind_;
+    that.clear ();
+  }
+
+  parser::symbol_kind_type
+  parser::by_kind::kind () const YY_NOEXCEPT
+  {
+    return kind_;
+  }
+
+
+  parser::symbol_kind_type
+  parser::by_kind::type_get () const YY_NOEXCEPT
+  {
+    return this->kind ();
+  }
+
+
+
+  // by_state.
+  parser::by_state::by_state () YY_NOEXCEPT
+    : state (empty_state)
+  {}
+
+  parser::by_state::by_state (const by_state& that) YY_NOEXCEPT
+    : state (that.state)
+  {}
+
+  void
+  parser::by_state::clear () YY_NOEXCEPT
+  {
+    state = empty_state;
+  }
+
+  void
+  parser::by_state::move (by_state& that)
+  {
+    state = that.state;
+    that.clear ();
+  }
+
+  parser::by_state::by_state (state_type s) YY_NOEXCEPT
+    : state (s)
+  {}
+
+  parser::symbol_kind_type
+  parser::by_state::kind () const YY_NOEXCEPT
+  {
+    if (state == empty_state)
+      return symbol_kind::S_YYEMPTY;
+    else
+      return YY_CAST (symbol_kind_type, yystos_[+state]);
+  }
+
+  parser::stack_symbol_type::stack_symbol_type ()
+  {}
+
+  parser::stack_symbol_type::stack_symbol_type (YY_RVREF (stack_symbol_type) that)
+    : super_type (YY_MOVE (that.state), YY_MOVE (that.value), YY_MOVE (that.location))
+  {
+#if 201103L <= YY_CPLUSPLUS
+    // that is emptied.
+    that.state = empty_state;
+#endif
+  }
+
+  parser::stack_symbol_type::stack_symbol_type (state_type s, YY_MOVE_REF (symbol_type) that)
+    : super_type (s, YY_MOVE (that.value), YY_MOVE (that.location))
+  {
+    // that is emptied.
+    that.kind_ = symbol_kind::S_YYEMPTY;
+  }
+
+#if YY_CPLUSPLUS < 201103L
+  parser::stack_symbol_type&
+  parser::stack_symbol_type::operator= (const stack_symbol_type& that)
+  {
+    state = that.state;
+    value = that.value;
+    location = that.location;
+    return *this;
+  }
+
+  parser::stack_symbol_type&
+  parser::stack_symbol_type::operator= (stack_symbol_type& that)
+  {
+    state = that.state;
+    value = that.value;
+    location = that.location;
+    // that is emptied.
+    that.state = empty_state;
+    return *this;
+  }
+#endif
+
+  template <typename Base>
+  void
+  parser::yy_destroy_ (const char* yymsg, basic_symbol<Base>& yysym) const
+  {
+    if (yymsg)
+      YY_SYMBOL_PRINT (yymsg, yysym);
+
+    // User destructor.
+    YY_USE (yysym.kind ());
+  }
+
+#if YYDEBUG
+  template <typename Base>
+  void
+  parser::yy_print_ (std::ostream& yyo, const basic_symbol<Base>& yysym) const
+  {
+    std::ostream& yyoutput = yyo;
+    YY_USE (yyoutput);
+    if (yysym.empty ())
+      yyo << "empty symbol";
+    else
+      {
+        symbol_kind_type yykind = yysym.kind ();
+        yyo << (yykind < YYNTOKENS ? "token" : "nterm")
+            << ' ' << yysym.name () << " ("
+            << yysym.location << ": ";
+        YY_USE (yykind);
+        yyo << ')';
+      }
+  }
+#endif
+
+  void
+  parser::yypush_ (const char* m, YY_MOVE_REF (stack_symbol_type) sym)
+  {
+    if (m)
+      YY_SYMBOL_PRINT (m, sym);
+    yystack_.push (YY_MOVE (sym));
+  }
+
+  void
+  parser::yypush_ (const char* m, state_type s, YY_MOVE_REF (symbol_type) sym)
+  {
+#if 201103L <= YY_CPLUSPLUS
+    yypush_ (m, stack_symbol_type (s, std::move (sym)));
+#else
+    stack_symbol_type ss (s, sym);
+    yypush_ (m, ss);
+#endif
+  }
+
+  void
+  parser::yypop_ (int n) YY_NOEXCEPT
+  {
+    yystack_.pop (n);
+  }
+
+#if YYDEBUG
+  std::ostream&
+  parser::debug_stream () const
+  {
+    return *yycdebug_;
+  }
+
+  void
+  parser::set_debug_stream (std::ostream& o)
+  {
+    yycdebug_ = &o;
+  }
+
+
+  parser::debug_level_type
+  parser::debug_level () const
+  {
+    return yydebug_;
+  }
+
+  void
+  parser::set_debug_level (debug_level_type l)
+  {
+    yydebug_ = l;
+  }
+#endif // YYDEBUG
+
+  parser::state_type
+  parser::yy_lr_goto_state_ (state_type yystate, int yysym)
+  {
+    int yyr = yypgoto_[yysym - YYNTOKENS] + yystate;
+    if (0 <= yyr && yyr <= yylast_ && yycheck_[yyr] == yystate)
+      return yytable_[yyr];
+    else
+      return yydefgoto_[yysym - YYNTOKENS];
+  }
+
+  bool
+  parser::yy_pact_value_is_default_ (int yyvalue) YY_NOEXCEPT
+  {
+    return yyvalue == yypact_ninf_;
+  }
+
+  bool
+  parser::yy_table_value_is_error_ (int yyvalue) YY_NOEXCEPT
+  {
+    return yyvalue == yytable_ninf_;
+  }
+
+  int
+  parser::operator() ()
+  {
+    return parse ();
+  }
+
+  int
+  parser::parse ()
+  {
+    int yyn;
+    /// Length of the RHS of the rule being reduced.
+    int yylen = 0;
+
+    // Error handling.
+    int yynerrs_ = 0;
+    int yyerrstatus_ = 0;
+
+    /// The lookahead symbol.
+    symbol_type yyla;
+
+    /// The locations where the error started and ended.
+    stack_symbol_type yyerror_range[3];
+
+    /// The return value of parse ().
+    int yyresult;
+
+#if YY_EXCEPTIONS
+    try
+#endif // YY_EXCEPTIONS
+      {
+    YYCDEBUG << "Starting parse\n";
+
+
+    /* Initialize the stack.  The initial state will be set in
+       yynewstate, since the latter expects the semantical and the
+       location values to have been already stored, initialize these
+       stacks with a primary value.  */
+    yystack_.clear ();
+    yypush_ (YY_NULLPTR, 0, YY_MOVE (yyla));
+
+  /*-----------------------------------------------.
+  | yynewstate -- push a new symbol on the stack.  |
+  `-----------------------------------------------*/
+  yynewstate:
+    YYCDEBUG << "Entering state " << int (yystack_[0].state) << '\n';
+    YY_STACK_PRINT ();
+
+    // Accept?
+    if (yystack_[0].state == yyfinal_)
+      YYACCEPT;
+
+    goto yybackup;
+
+
+  /*-----------.
+  | yybackup.  |
+  `-----------*/
+  yybackup:
+    // Try to take a decision without lookahead.
+    yyn = yypact_[+yystack_[0].state];
+    if (yy_pact_value_is_default_ (yyn))
+      goto yydefault;
+
+    // Read a lookahead token.
+    if (yyla.empty ())
+      {
+        YYCDEBUG << "Reading a token\n";
+#if YY_EXCEPTIONS
+        try
+#endif // YY_EXCEPTIONS
+          {
+            yyla.kind_ = yytranslate_ (yylex (&yyla.value, &yyla.location));
+          }
+#if YY_EXCEPTIONS
+        catch (const syntax_error& yyexc)
+          {
+            YYCDEBUG << "Caught exception: " << yyexc.what() << '\n';
+            error (yyexc);
+            goto yyerrlab1;
+          }
+#endif // YY_EXCEPTIONS
+      }
+    YY_SYMBOL_PRINT ("Next token is", yyla);
+
+    if (yyla.kind () == symbol_kind::S_YYerror)
+    {
+      // The scanner already issued an error message, process directly
+      // to error recovery.  But do not keep the error token as
+      // lookahead, it is too special and may lead us to an endless
+      // loop in error recovery. */
+      yyla.kind_ = symbol_kind::S_YYUNDEF;
+      goto yyerrlab1;
+    }
+
+    /* If the proper action on seeing token YYLA.TYPE is to reduce or
+       to detect an error, take that action.  */
+    yyn += yyla.kind ();
+    if (yyn < 0 || yylast_ < yyn || yycheck_[yyn] != yyla.kind ())
+      {
+        goto yydefault;
+      }
+
+    // Reduce or error.
+    yyn = yytable_[yyn];
+    if (yyn <= 0)
+      {
+        if (yy_table_value_is_error_ (yyn))
+          goto yyerrlab;
+        yyn = -yyn;
+        goto yyreduce;
+      }
+
+    // Count tokens shifted since error; after three, turn off error status.
+    if (yyerrstatus_)
+      --yyerrstatus_;
+
+    // Shift the lookahead token.
+    yypush_ ("Shifting", state_type (yyn), YY_MOVE (yyla));
+    goto yynewstate;
+
+
+  /*-----------------------------------------------------------.
+  | yydefault -- do the default action for the current state.  |
+  `-----------------------------------------------------------*/
+  yydefault:
+    yyn = yydefact_[+yystack_[0].state];
+    if (yyn == 0)
+      goto yyerrlab;
+    goto yyreduce;
+
+
+  /*-----------------------------.
+  | yyreduce -- do a reduction.  |
+  `-----------------------------*/
+  yyreduce:
+    yylen = yyr2_[yyn];
+    {
+      stack_symbol_type yylhs;
+      yylhs.state = yy_lr_goto_state_ (yystack_[yylen].state, yyr1_[yyn]);
+      /* If YYLEN is nonzero, implement the default value of the
+         action: '$$ = $1'.  Otherwise, use the top of the stack.
+
+         Otherwise, the following line sets YYLHS.VALUE to garbage.
+         This behavior is undocumented and Bison users should not rely
+         upon it.  */
+      if (yylen)
+        yylhs.value = yystack_[yylen - 1].value;
+      else
+        yylhs.value = yystack_[0].value;
+
+      // Default location.
+      {
+        stack_type::slice range (yystack_, yylen);
+        YYLLOC_DEFAULT (yylhs.location, range, yylen);
+        yyerror_range[1].location = yylhs.location;
+      }
+
+      // Perform the reduction.
+      YY_REDUCE_PRINT (yyn);
+#if YY_EXCEPTIONS
+      try
+#endif // YY_EXCEPTIONS
+        {
+          switch (yyn)
+            {
+  case 2: // pgm: classes statements
+#line 148 "quack.yxx"
+        { (yylhs.value.program) = new AST::Program(*(yystack_[1].value.classes), *(yystack_[0].value.block));
+          *root = (yylhs.value.program); // Transmit tree back to driver
+        }
+#line 622 "quack.tab.cxx"
+    break;
+
+  case 3: // classes: classes clazz
+#line 154 "quack.yxx"
+                          { (yylhs.value.classes) = (yystack_[1].value.classes); (yylhs.value.classes)->append((yystack_[0].value.clazz)); }
+#line 628 "quack.tab.cxx"
+    break;
+
+  case 4: // classes: %empty
+#line 155 "quack.yxx"
+                          {  (yylhs.value.classes) = new AST::Classes(); }
+#line 634 "quack.tab.cxx"
+    break;
+
+  case 5: // clazz: CLASS ident '(' formal_args ')' '{' statements methods '}'
+#line 161 "quack.yxx"
+              { (yylhs.value.clazz) = new AST::Class(*(yystack_[7].value.ident), *(new AST::Ident("Obj")), 
+                        *(new AST::Method(*(yystack_[7].value.ident), *(yystack_[5].value.formals), *(yystack_[7].value.ident), *(yystack_[2].value.block))),
+                        *(yystack_[1].value.methods)); }
+#line 642 "quack.tab.cxx"
+    break;
+
+  case 6: // clazz: CLASS ident '(' formal_args ')' EXTENDS ident '{' statements methods '}'
+#line 165 "quack.yxx"
+              { (yylhs.value.clazz) = new AST::Class(*(yystack_[9].value.ident), *(yystack_[4].value.ident), 
+                            *(new AST::Method(*(yystack_[9].value.ident), *(yystack_[7].value.formals), *(yystack_[9].value.ident), *(yystack_[2].value.block))), *(yystack_[1].value.methods)); }
+#line 649 "quack.tab.cxx"
+    break;
+
+  case 7: // methods: methods method
+#line 171 "quack.yxx"
+                        { (yylhs.value.methods) = (yystack_[1].value.methods); (yylhs.value.methods)->append((yystack_[0].value.method)); }
+#line 655 "quack.tab.cxx"
+    break;
+
+  case 8: // methods: %empty
+#line 172 "quack.yxx"
+                      { (yylhs.value.methods) = new AST::Methods(); }
+#line 661 "quack.tab.cxx"
+    break;
+
+  case 9: // method: DEF ident '(' formal_args ')' ':' ident statement_block
+#line 176 "quack.yxx"
+          { (yylhs.value.method) = new AST::Method(*(yystack_[6].value.ident), *(yystack_[4].value.formals), *(yystack_[1].value.ident), *(yystack_[0].value.block)); }
+#line 667 "quack.tab.cxx"
+    break;
+
+  case 10: // method: DEF ident '(' formal_args ')' statement_block
+#line 178 "quack.yxx"
+          { (yylhs.value.method) = new AST::Method(*(yystack_[4].value.ident), *(yystack_[2].value.formals), *(new AST::Ident("Nothing")), *(yystack_[0].value.block)); }
+#line 673 "quack.tab.cxx"
+    break;
+
+  case 11: // formal_args: formal_args_delim
+#line 182 "quack.yxx"
+                               { (yylhs.value.formals) = (yystack_[0].value.formals); }
+#line 679 "quack.tab.cxx"
+    break;
+
+  case 12: // formal_args: %empty
+#line 183 "quack.yxx"
+                      { (yylhs.value.formals) = new AST::Formals(); }
+#line 685 "quack.tab.cxx"
+    break;
+
+  case 13: // formal_args_delim: formal_args_delim ',' formal_arg
+#line 186 "quack.yxx"
+              { (yylhs.value.formals) = (yystack_[2].value.formals); (yylhs.value.formals)->append((yystack_[0].value.formal)); }
+#line 691 "quack.tab.cxx"
+    break;
+
+  case 14: // formal_args_delim: formal_arg
+#line 187 "quack.yxx"
+                     { (yylhs.value.formals) = new AST::Formals(); (yylhs.value.formals)->append((yystack_[0].value.formal)); }
+#line 697 "quack.tab.cxx"
+    break;
+
+  case 15: // formal_arg: ident ':' ident
+#line 189 "quack.yxx"
+                            { (yylhs.value.formal) = new AST::Formal(*(yystack_[2].value.ident), *(yystack_[0].value.ident)); }
+#line 703 "quack.tab.cxx"
+    break;
+
+  case 16: // statements: statements statement
+#line 198 "quack.yxx"
+                                  { (yylhs.value.block) = (yystack_[1].value.block); (yylhs.value.block)->append((yystack_[0].value.statement)); }
+#line 709 "quack.tab.cxx"
+    break;
+
+  case 17: // statements: %empty
+#line 199 "quack.yxx"
+                                  { (yylhs.value.block) = new AST::Block(); }
+#line 715 "quack.tab.cxx"
+    break;
+
+  case 18: // statement_block: '{' statements '}'
+#line 202 "quack.yxx"
+                                    {  (yylhs.value.block) = (yystack_[1].value.block); }
+#line 721 "quack.tab.cxx"
+    break;
+
+  case 19: // statement: IF expr statement_block opt_elif_parts
+#line 214 "quack.yxx"
+               { (yylhs.value.statement) = new AST::If(*(yystack_[2].value.expr), *(yystack_[1].value.block), *(yystack_[0].value.block)); }
+#line 727 "quack.tab.cxx"
+    break;
+
+  case 20: // opt_elif_parts: ELIF expr statement_block opt_elif_parts
+#line 217 "quack.yxx"
+                { (yylhs.value.block) = new AST::Block();
+                  (yylhs.value.block)->append(new AST::If(*(yystack_[2].value.expr), *(yystack_[1].value.block), *(yystack_[0].value.block))); }
+#line 734 "quack.tab.cxx"
+    break;
+
+  case 21: // opt_elif_parts: ELSE statement_block
+#line 219 "quack.yxx"
+                                { (yylhs.value.block) = (yystack_[0].value.block); }
+#line 740 "quack.tab.cxx"
+    break;
+
+  case 22: // opt_elif_parts: %empty
+#line 220 "quack.yxx"
+                                { (yylhs.value.block) = new AST::Block(); }
+#line 746 "quack.tab.cxx"
+    break;
+
+  case 23: // statement: WHILE expr statement_block
+#line 225 "quack.yxx"
+            { (yylhs.value.statement) = new AST::While(*(yystack_[1].value.expr), *(yystack_[0].value.block)); }
+#line 752 "quack.tab.cxx"
+    break;
+
+  case 24: // statement: l_expr '=' expr ';'
+#line 234 "quack.yxx"
+            { (yylhs.value.statement) = new AST::Assign(*(yystack_[3].value.l_expr), *(yystack_[1].value.expr)); }
+#line 758 "quack.tab.cxx"
+    break;
+
+  case 25: // statement: l_expr ':' ident '=' expr ';'
+#line 236 "quack.yxx"
+            { (yylhs.value.statement) = new AST::AssignDeclare(*(yystack_[5].value.l_expr), *(yystack_[1].value.expr), *(yystack_[3].value.ident)); }
+#line 764 "quack.tab.cxx"
+    break;
+
+  case 26: // statement: expr ';'
+#line 238 "quack.yxx"
+            { (yylhs.value.statement) = (yystack_[1].value.expr); }
+#line 770 "quack.tab.cxx"
+    break;
+
+  case 27: // l_expr: IDENT
+#line 249 "quack.yxx"
+                           { (yylhs.value.l_expr) =  new AST::Ident((yystack_[0].value.str));   }
+#line 776 "quack.tab.cxx"
+    break;
+
+  case 28: // l_expr: expr '.' IDENT
+#line 250 "quack.yxx"
+                           { (yylhs.value.l_expr) = new AST::Dot(*(yystack_[2].value.expr), *(new AST::Ident((yystack_[0].value.str)))); }
+#line 782 "quack.tab.cxx"
+    break;
+
+  case 29: // expr: l_expr
+#line 265 "quack.yxx"
+             { (yylhs.value.expr) = new AST::Load(*(yystack_[0].value.l_expr)); }
+#line 788 "quack.tab.cxx"
+    break;
+
+  case 30: // expr: STRING_LIT
+#line 268 "quack.yxx"
+                 { (yylhs.value.expr) = new AST::StrConst((yystack_[0].value.str)); }
+#line 794 "quack.tab.cxx"
+    break;
+
+  case 31: // expr: INT_LIT
+#line 269 "quack.yxx"
+                 { (yylhs.value.expr) = new AST::IntConst((yystack_[0].value.num)); }
+#line 800 "quack.tab.cxx"
+    break;
+
+  case 32: // expr: '(' expr ')'
+#line 273 "quack.yxx"
+                   { (yylhs.value.expr) = (yystack_[1].value.expr); }
+#line 806 "quack.tab.cxx"
+    break;
+
+  case 33: // expr: expr '*' expr
+#line 282 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("TIMES", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 812 "quack.tab.cxx"
+    break;
+
+  case 34: // expr: expr '/' expr
+#line 283 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("DIVIDE", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 818 "quack.tab.cxx"
+    break;
+
+  case 35: // expr: expr '+' expr
+#line 284 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("PLUS", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 824 "quack.tab.cxx"
+    break;
+
+  case 36: // expr: expr '-' expr
+#line 285 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("MINUS", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 830 "quack.tab.cxx"
+    break;
+
+  case 37: // expr: '-' expr
+#line 286 "quack.yxx"
+                            {
+                              auto zero = new AST::IntConst(0);
+                              (yylhs.value.expr) = AST::Call::binop("MINUS", *zero, *(yystack_[0].value.expr));
+                            }
+#line 839 "quack.tab.cxx"
+    break;
+
+  case 38: // expr: expr EQUALS expr
+#line 290 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("EQUALS", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 845 "quack.tab.cxx"
+    break;
+
+  case 39: // expr: expr ATMOST expr
+#line 291 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("ATMOST", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 851 "quack.tab.cxx"
+    break;
+
+  case 40: // expr: expr '<' expr
+#line 292 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("LESS", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 857 "quack.tab.cxx"
+    break;
+
+  case 41: // expr: expr ATLEAST expr
+#line 293 "quack.yxx"
+                        { (yylhs.value.expr) = AST::Call::binop("ATLEAST", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 863 "quack.tab.cxx"
+    break;
+
+  case 42: // expr: expr '>' expr
+#line 294 "quack.yxx"
+                       { (yylhs.value.expr) = AST::Call::binop("GREATER", *(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 869 "quack.tab.cxx"
+    break;
+
+  case 43: // expr: expr AND expr
+#line 297 "quack.yxx"
+                          { (yylhs.value.expr) = new AST::And(*(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 875 "quack.tab.cxx"
+    break;
+
+  case 44: // expr: expr OR expr
+#line 298 "quack.yxx"
+                         { (yylhs.value.expr) = new AST::Or(*(yystack_[2].value.expr), *(yystack_[0].value.expr)); }
+#line 881 "quack.tab.cxx"
+    break;
+
+  case 45: // expr: NOT expr
+#line 299 "quack.yxx"
+                     { (yylhs.value.expr) = new AST::Not(*(yystack_[0].value.expr)); }
+#line 887 "quack.tab.cxx"
+    break;
+
+  case 46: // expr: expr '.' ident '(' actual_args ')'
+#line 318 "quack.yxx"
+        { (yylhs.value.expr) = new AST::Call(*(yystack_[5].value.expr), *(yystack_[3].value.ident), *(yystack_[1].value.actuals)); }
+#line 893 "quack.tab.cxx"
+    break;
+
+  case 47: // actual_args: %empty
+#line 320 "quack.yxx"
+                        { (yylhs.value.actuals) = new AST::Actuals(); }
+#line 899 "quack.tab.cxx"
+    break;
+
+  case 48: // actual_args: actual_args_nonempty
+#line 321 "quack.yxx"
+                                   { (yylhs.value.actuals) = (yystack_[0].value.actuals); }
+#line 905 "quack.tab.cxx"
+    break;
+
+  case 49: // actual_args_nonempty: actual_args_nonempty ',' expr
+#line 324 "quack.yxx"
+                                          { (yylhs.value.actuals) = (yystack_[2].value.actuals); (yylhs.value.actuals)->append((yystack_[0].value.expr)); }
+#line 911 "quack.tab.cxx"
+    break;
+
+  case 50: // actual_args_nonempty: expr
+#line 325 "quack.yxx"
+                  { (yylhs.value.actuals) = new AST::Actuals(); (yylhs.value.actuals)->append((yystack_[0].value.expr)); }
+#line 917 "quack.tab.cxx"
+    break;
+
+  case 51: // statement: return_expr
+#line 330 "quack.yxx"
+                       { (yylhs.value.statement) = (yystack_[0].value.return_expr); }
+#line 923 "quack.tab.cxx"
+    break;
+
+  case 52: // return_expr: RETURN expr ';'
+#line 333 "quack.yxx"
+              { (yylhs.value.return_expr) = new AST::Return(*(yystack_[1].value.expr)); }
+#line 929 "quack.tab.cxx"
+    break;
+
+  case 53: // return_expr: RETURN ';'
+#line 335 "quack.yxx"
+              { (yylhs.value.return_expr) = new AST::Return(*(new AST::Ident("None"))); }
+#line 935 "quack.tab.cxx"
+    break;
+
+  case 54: // statement: typecase
+#line 339 "quack.yxx"
+                    { (yylhs.value.statement) = (yystack_[0].value.typecase); }
+#line 941 "quack.tab.cxx"
+    break;
+
+  case 55: // typecase: TYPECASE expr '{' type_alternatives '}'
+#line 342 "quack.yxx"
+    { (yylhs.value.typecase) = new AST::Typecase(*(yystack_[3].value.expr), *(yystack_[1].value.type_alternatives)); }
+#line 947 "quack.tab.cxx"
+    break;
+
+  case 56: // type_alternatives: type_alternatives type_alternative
+#line 345 "quack.yxx"
+            { (yylhs.value.type_alternatives) = (yystack_[1].value.type_alternatives); (yylhs.value.type_alternatives)->append((yystack_[0].value.type_alternative)); }
+#line 953 "quack.tab.cxx"
+    break;
+
+  case 57: // type_alternatives: %empty
+#line 346 "quack.yxx"
+                      { (yylhs.value.type_alternatives) = new AST::Type_Alternatives(); }
+#line 959 "quack.tab.cxx"
+    break;
+
+  case 58: // type_alternative: ident ':' ident statement_block
+#line 349 "quack.yxx"
+          { (yylhs.value.type_alternative) = new AST::Type_Alternative(*(yystack_[3].value.ident), *(yystack_[1].value.ident), *(yystack_[0].value.block)); }
+#line 965 "quack.tab.cxx"
+    break;
+
+  case 59: // expr: ident '(' actual_args ')'
+#line 355 "quack.yxx"
+   { (yylhs.value.expr) = new AST::Construct(*(yystack_[3].value.ident), *(yystack_[1].value.actuals)); }
+#line 971 "quack.tab.cxx"
+    break;
+
+  case 60: // ident: IDENT
+#line 357 "quack.yxx"
+             { (yylhs.value.ident) = new AST::Ident((yystack_[0].value.str)); }
+#line 977 "quack.tab.cxx"
+    break;
+
+
+#line 981 "quack.tab.cxx"
+
+            default:
+              break;
+            }
+        }
+#if YY_EXCEPTIONS
+      catch (const syntax_error& yyexc)
+        {
+          YYCDEBUG << "Caught exception: " << yyexc.what() << '\n';
+          error (yyexc);
+          YYERROR;
+        }
+#endif // YY_EXCEPTIONS
+      YY_SYMBOL_PRINT ("-> $$ =", yylhs);
+      yypop_ (yylen);
+      yylen = 0;
+
+      // Shift the result of the reduction.
+      yypush_ (YY_NULLPTR, YY_MOVE (yylhs));
+    }
+    goto yynewstate;
+
+
+  /*--------------------------------------.
+  | yyerrlab -- here on detecting error.  |
+  `--------------------------------------*/
+  yyerrlab:
+    // If not already recovering from an error, report this error.
+    if (!yyerrstatus_)
+      {
+        ++yynerrs_;
+        std::string msg = YY_("syntax error");
+        error (yyla.location, YY_MOVE (msg));
+      }
+
+
+    yyerror_range[1].location = yyla.location;
+    if (yyerrstatus_ == 3)
+      {
+        /* If just tried and failed to reuse lookahead token after an
+           error, discard it.  */
+
+        // Return failure if at end of input.
+        if (yyla.kind () == symbol_kind::S_YYEOF)
+          YYABORT;
+        else if (!yyla.empty ())
+          {
+            yy_destroy_ ("Error: discarding", yyla);
+            yyla.clear ();
+          }
+      }
+
+    // Else will try to reuse lookahead token after shifting the error token.
+    goto yyerrlab1;
+
+
+  /*---------------------------------------------------.
+  | yyerrorlab -- error raised explicitly by YYERROR.  |
+  `---------------------------------------------------*/
+  yyerrorlab:
+    /* Pacify compilers when the user code never invokes YYERROR and
+       the label yyerrorlab therefore never appears in user code.  */
+    if (false)
+      YYERROR;
+
+    /* Do not reclaim the symbols of the rule whose action triggered
+       this YYERROR.  */
+    yypop_ (yylen);
+    yylen = 0;
+    YY_STACK_PRINT ();
+    goto yyerrlab1;
+
+
+  /*-------------------------------------------------------------.
+  | yyerrlab1 -- common code for both syntax error and YYERROR.  |
+  `-------------------------------------------------------------*/
+  yyerrlab1:
+    yyerrstatus_ = 3;   // Each real token shifted decrements this.
+    // Pop stack until we find a state that shifts the error token.
+    for (;;)
+      {
+        yyn = yypact_[+yystack_[0].state];
+        if (!yy_pact_value_is_default_ (yyn))
+          {
+            yyn += symbol_kind::S_YYerror;
+            if (0 <= yyn && yyn <= yylast_
+                && yycheck_[yyn] == symbol_kind::S_YYerror)
+              {
+                yyn = yytable_[yyn];
+                if (0 < yyn)
+                  break;
+              }
+          }
+
+        // Pop the current state because it cannot handle the error token.
+        if (yystack_.size () == 1)
+          YYABORT;
+
+        yyerror_range[1].location = yystack_[0].location;
+        yy_destroy_ ("Error: popping", yystack_[0]);
+        yypop_ ();
+        YY_STACK_PRINT ();
+      }
+    {
+      stack_symbol_type error_token;
+
+      yyerror_range[2].location = yyla.location;
+      YYLLOC_DEFAULT (error_token.location, yyerror_range, 2);
+
+      // Shift the error token.
+      error_token.state = state_type (yyn);
+      yypush_ ("Shifting", YY_MOVE (error_token));
+    }
+    goto yynewstate;
+
+
+  /*-------------------------------------.
+  | yyacceptlab -- YYACCEPT comes here.  |
+  `-------------------------------------*/
+  yyacceptlab:
+    yyresult = 0;
+    goto yyreturn;
+
+
+  /*-----------------------------------.
+  | yyabortlab -- YYABORT comes here.  |
+  `-----------------------------------*/
+  yyabortlab:
+    yyresult = 1;
+    goto yyreturn;
+
+
+  /*-----------------------------------------------------.
+  | yyreturn -- parsing is finished, return the result.  |
+  `-----------------------------------------------------*/
+  yyreturn:
+    if (!yyla.empty ())
+      yy_destroy_ ("Cleanup: discarding lookahead", yyla);
+
+    /* Do not reclaim the symbols of the rule whose action triggered
+       this YYABORT or YYACCEPT.  */
+    yypop_ (yylen);
+    YY_STACK_PRINT ();
+    while (1 < yystack_.size ())
+      {
+        yy_destroy_ ("Cleanup: popping", yystack_[0]);
+        yypop_ ();
+      }
+
+    return yyresult;
+  }
+#if YY_EXCEPTIONS
+    catch (...)
+      {
+        YYCDEBUG << "Exception caught: cleaning lookahead and stack\n";
+        // Do not try to display the values of the reclaimed symbols,
+        // as their printers might throw an exception.
+        if (!yyla.empty ())
+          yy_destroy_ (YY_NULLPTR, yyla);
+
+        while (1 < yystack_.size ())
+          {
+            yy_destroy_ (YY_NULLPTR, yystack_[0]);
+            yypop_ ();
+          }
+        throw;
+      }
+#endif // YY_EXCEPTIONS
+  }
+
+  void
+  parser::error (const syntax_error& yyexc)
+  {
+    error (yyexc.location, yyexc.what ());
+  }
+
+#if YYDEBUG || 1
+  const char *
+  parser::symbol_name (symbol_kind_type yysymbol)
+  {
+    return yytname_[yysymbol];
+  }
+#endif // #if YYDEBUG || 1
+
+
+
+
+
+
+
+
+
+  const signed char parser::yypact_ninf_ = -54;
+
+  const signed char parser::yytable_ninf_ = -61;
+
+  const short
+  parser::yypact_[] =
+  {
+     -54,    14,    16,   -54,    15,   -54,   200,   -54,     7,   338,
+     338,    66,   338,   338,     8,   -54,   -54,   338,   338,   -54,
+     -26,    38,   -54,   -54,    10,    15,   -54,   218,   218,   -54,
+     137,   238,   294,    13,   258,    15,   338,   338,   338,   338,
+     338,   338,   338,   338,   338,   338,   338,   338,    24,   -54,
+     338,    17,     9,   -54,    12,   -54,    20,   -54,   -54,   -54,
+     -54,    11,   154,   326,   311,    68,   294,   294,   311,   326,
+     -15,   -15,    13,    13,     8,    19,   277,    25,    22,    -2,
+      15,    15,     6,   338,    18,   -54,   -10,   338,   -54,   338,
+     -54,   338,    15,   -54,   -54,   -54,   -54,   218,   -54,   -54,
+     -54,    32,   179,    37,   277,    40,   200,    20,    15,   -54,
+     -54,   -54,     0,   -54,    18,   200,    15,   -54,   -54,   -54,
+       2,    39,   -54,    15,    42,   -13,    15,   -54,    18,   -54
+  };
+
+  const signed char
+  parser::yydefact_[] =
+  {
+       4,     0,    17,     1,     0,     3,     2,    60,     0,     0,
+       0,     0,     0,     0,    27,    31,    30,     0,     0,    16,
+      29,     0,    51,    54,     0,    12,    29,     0,     0,    53,
+       0,     0,    45,    37,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,    26,
+      47,     0,    11,    14,     0,    17,    22,    23,    52,    57,
+      32,     0,     0,    41,    39,    38,    43,    44,    42,    40,
+      35,    36,    33,    34,    28,     0,    50,     0,    48,     0,
+       0,     0,     0,     0,     0,    19,     0,     0,    24,    47,
+      59,     0,     0,    17,    13,    15,    18,     0,    21,    55,
+      56,     0,     0,     0,    49,     0,     8,    22,     0,    25,
+      46,    17,     0,    20,     0,     8,     0,     5,     7,    58,
+       0,     0,     6,    12,     0,     0,     0,    10,     0,     9
+  };
+
+  const signed char
+  parser::yypgoto_[] =
+  {
+     -54,   -54,   -54,   -54,   -46,   -54,   -50,   -54,    -5,   -53,
+     -27,   -54,   -29,    -1,    98,    -9,   -54,   -54,   -54,   -54,
+     -54,    -4
+  };
+
+  const signed char
+  parser::yydefgoto_[] =
+  {
+       0,     1,     2,     5,   112,   118,    51,    52,    53,     6,
+      56,    19,    85,    26,    21,    77,    78,    22,    23,    86,
+     100,    24
+  };
+
+  const short
+  parser::yytable_[] =
+  {
+       8,    57,    82,    92,   116,    20,   116,    35,     7,    36,
+      46,    47,     9,    48,     3,    10,    11,    12,    55,     4,
+     126,    54,    99,    13,    14,    15,    16,    83,    84,    93,
+      17,    61,   117,     7,   122,    18,    25,   -60,    96,    50,
+     106,    48,    74,    80,    75,    81,    87,    79,    89,    55,
+      37,    38,    39,    40,    41,    90,    91,    98,   115,    42,
+      43,    44,    45,    46,    47,   108,    48,   110,   123,   120,
+     107,   111,   125,   124,    49,    94,    54,    95,   113,     0,
+     103,    20,   101,    13,    14,    15,    16,   119,   105,     0,
+      17,    44,    45,    46,    47,    18,    48,     0,   127,     0,
+       0,   129,    29,     0,   114,    20,     0,    27,    28,    30,
+      31,    32,   121,     0,    20,    33,    34,     0,     0,    54,
+       0,     0,   128,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,    62,    63,    64,    65,    66,    67,
+      68,    69,    70,    71,    72,    73,     0,     0,    76,    37,
+      38,    39,    40,    41,     0,     0,     0,     0,    42,    43,
+      44,    45,    46,    47,     0,    48,    37,    38,    39,    40,
+      41,     0,     0,    58,     0,    42,    43,    44,    45,    46,
+      47,    97,    48,     0,     0,   102,     0,    76,     0,   104,
+      88,    37,    38,    39,    40,    41,     0,     0,     0,     0,
+      42,    43,    44,    45,    46,    47,     9,    48,     0,    10,
+      11,    12,     0,     0,     0,   109,     0,    13,    14,    15,
+      16,     0,     0,     0,    17,     0,     0,     0,     0,    18,
+      37,    38,    39,    40,    41,     0,     0,     0,     0,    42,
+      43,    44,    45,    46,    47,     0,    48,     0,     0,    55,
+      37,    38,    39,    40,    41,     0,     0,     0,     0,    42,
+      43,    44,    45,    46,    47,     0,    48,     0,     0,    59,
+      37,    38,    39,    40,    41,     0,     0,     0,     0,    42,
+      43,    44,    45,    46,    47,     0,    48,     0,    60,    37,
+      38,    39,    40,    41,     0,     0,     0,     0,    42,    43,
+      44,    45,    46,    47,     0,    48,    37,    38,    39,     0,
+       0,     0,     0,     0,     0,    42,    43,    44,    45,    46,
+      47,     0,    48,    37,   -61,    39,     0,     0,     0,     0,
+       0,     0,   -61,    43,    44,    45,    46,    47,   -61,    48,
+      39,     0,     0,     0,     0,     0,     0,     0,   -61,    44,
+      45,    46,    47,     0,    48,    13,    14,    15,    16,     0,
+       0,     0,    17,     0,     0,     0,     0,    18
+  };
+
+  const short
+  parser::yycheck_[] =
+  {
+       4,    28,    55,     5,     4,     6,     4,    33,    18,    35,
+      25,    26,     6,    28,     0,     9,    10,    11,    31,     3,
+      33,    25,    32,    17,    18,    19,    20,     7,     8,    31,
+      24,    35,    32,    18,    32,    29,    29,    29,    32,    29,
+      93,    28,    18,    34,    48,    33,    35,    30,    29,    31,
+      12,    13,    14,    15,    16,    30,    34,    84,   111,    21,
+      22,    23,    24,    25,    26,    33,    28,    30,    29,   115,
+      97,    31,    30,   123,    36,    80,    80,    81,   107,    -1,
+      89,    82,    86,    17,    18,    19,    20,   114,    92,    -1,
+      24,    23,    24,    25,    26,    29,    28,    -1,   125,    -1,
+      -1,   128,    36,    -1,   108,   106,    -1,     9,    10,    11,
+      12,    13,   116,    -1,   115,    17,    18,    -1,    -1,   123,
+      -1,    -1,   126,    -1,    -1,    -1,    -1,    -1,    -1,    -1,
+      -1,    -1,    -1,    -1,    36,    37,    38,    39,    40,    41,
+      42,    43,    44,    45,    46,    47,    -1,    -1,    50,    12,
+      13,    14,    15,    16,    -1,    -1,    -1,    -1,    21,    22,
+      23,    24,    25,    26,    -1,    28,    12,    13,    14,    15,
+      16,    -1,    -1,    36,    -1,    21,    22,    23,    24,    25,
+      26,    83,    28,    -1,    -1,    87,    -1,    89,    -1,    91,
+      36,    12,    13,    14,    15,    16,    -1,    -1,    -1,    -1,
+      21,    22,    23,    24,    25,    26,     6,    28,    -1,     9,
+      10,    11,    -1,    -1,    -1,    36,    -1,    17,    18,    19,
+      20,    -1,    -1,    -1,    24,    -1,    -1,    -1,    -1,    29,
+      12,    13,    14,    15,    16,    -1,    -1,    -1,    -1,    21,
+      22,    23,    24,    25,    26,    -1,    28,    -1,    -1,    31,
+      12,    13,    14,    15,    16,    -1,    -1,    -1,    -1,    21,
+      22,    23,    24,    25,    26,    -1,    28,    -1,    -1,    31,
+      12,    13,    14,    15,    16,    -1,    -1,    -1,    -1,    21,
+      22,    23,    24,    25,    26,    -1,    28,    -1,    30,    12,
+      13,    14,    15,    16,    -1,    -1,    -1,    -1,    21,    22,
+      23,    24,    25,    26,    -1,    28,    12,    13,    14,    -1,
+      -1,    -1,    -1,    -1,    -1,    21,    22,    23,    24,    25,
+      26,    -1,    28,    12,    13,    14,    -1,    -1,    -1,    -1,
+      -1,    -1,    21,    22,    23,    24,    25,    26,    12,    28,
+      14,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    22,    23,
+      24,    25,    26,    -1,    28,    17,    18,    19,    20,    -1,
+      -1,    -1,    24,    -1,    -1,    -1,    -1,    29
+  };
+
+  const signed char
+  parser::yystos_[] =
+  {
+       0,    38,    39,     0,     3,    40,    46,    18,    58,     6,
+       9,    10,    11,    17,    18,    19,    20,    24,    29,    48,
+      50,    51,    54,    55,    58,    29,    50,    51,    51,    36,
+      51,    51,    51,    51,    51,    33,    35,    12,    13,    14,
+      15,    16,    21,    22,    23,    24,    25,    26,    28,    36,
+      29,    43,    44,    45,    58,    31,    47,    47,    36,    31,
+      30,    58,    51,    51,    51,    51,    51,    51,    51,    51,
+      51,    51,    51,    51,    18,    58,    51,    52,    53,    30,
+      34,    33,    46,     7,     8,    49,    56,    35,    36,    29,
+      30,    34,     5,    31,    45,    58,    32,    51,    47,    32,
+      57,    58,    51,    52,    51,    58,    46,    47,    33,    36,
+      30,    31,    41,    49,    58,    46,     4,    32,    42,    47,
+      41,    58,    32,    29,    43,    30,    33,    47,    58,    47
+  };
+
+  const signed char
+  parser::yyr1_[] =
+  {
+       0,    37,    38,    39,    39,    40,    40,    41,    41,    42,
+      42,    43,    43,    44,    44,    45,    46,    46,    47,    48,
+      49,    49,    49,    48,    48,    48,    48,    50,    50,    51,
+      51,    51,    51,    51,    51,    51,    51,    51,    51,    51,
+      51,    51,    51,    51,    51,    51,    51,    52,    52,    53,
+      53,    48,    54,    54,    48,    55,    56,    56,    57,    51,
+      58
+  };
+
+  const signed char
+  parser::yyr2_[] =
+  {
+       0,     2,     2,     2,     0,     9,    11,     2,     0,     8,
+       6,     1,     0,     3,     1,     3,     2,     0,     3,     4,
+       4,     2,     0,     3,     4,     6,     2,     1,     3,     1,
+       1,     1,     3,     3,     3,     3,     3,     2,     3,     3,
+       3,     3,     3,     3,     3,     2,     6,     0,     1,     3,
+       1,     1,     3,     2,     1,     5,     2,     0,     4,     4,
+       1
+  };
+
+
+#if YYDEBUG || 1
+  // YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+  // First, the terminals, then, starting at \a YYNTOKENS, nonterminals.
+  const char*
+  const parser::yytname_[] =
+  {
+  "\"end of file\"", "error", "\"invalid token\"", "CLASS", "DEF",
+  "EXTENDS", "IF", "ELIF", "ELSE", "WHILE", "RETURN", "TYPECASE",
+  "ATLEAST", "ATMOST", "EQUALS", "AND", "OR", "NOT", "IDENT", "INT_LIT",
+  "STRING_LIT", "'>'", "'<'", "'+'", "'-'", "'*'", "'/'", "NEG", "'.'",
+  "'('", "')'", "'{'", "'}'", "':'", "','", "'='", "';'", "$accept", "pgm",
+  "classes", "clazz", "methods", "method", "formal_args",
+  "formal_args_delim", "formal_arg", "statements", "statement_block",
+  "statement", "opt_elif_parts", "l_expr", "expr", "actual_args",
+  "actual_args_nonempty", "return_expr", "typecase", "type_alternatives",
+  "type_alternative", "ident", YY_NULLPTR
+  };
+#endif
+
+
+#if YYDEBUG
+  const short
+  parser::yyrline_[] =
+  {
+       0,   147,   147,   154,   155,   160,   164,   171,   172,   175,
+     177,   182,   183,   185,   187,   189,   198,   199,   202,   213,
+     216,   219,   220,   224,   233,   235,   237,   249,   250,   265,
+     268,   269,   273,   282,   283,   284,   285,   286,   290,   291,
+     292,   293,   294,   297,   298,   299,   317,   320,   321,   324,
+     325,   330,   332,   334,   339,   341,   344,   346,   348,   354,
+     357
+  };
+
+  void
+  parser::yy_stack_print_ () const
+  {
+    *yycdebug_ << "Stack now";
+    for (stack_type::const_iterator
+           i = yystack_.begin (),
+           i_end = yystack_.end ();
+         i != i_end; ++i)
+      *yycdebug_ << ' ' << int (i->state);
+    *yycdebug_ << '\n';
+  }
+
+  void
+  parser::yy_reduce_print_ (int yyrule) const
+  {
+    int yylno = yyrline_[yyrule];
+    int yynrhs = yyr2_[yyrule];
+    // Print the symbols being reduced, and their result.
+    *yycdebug_ << "Reducing stack by rule " << yyrule - 1
+               << " (line " << yylno << "):\n";
+    // The symbols being reduced.
+    for (int yyi = 0; yyi < yynrhs; yyi++)
+      YY_SYMBOL_PRINT ("   $" << yyi + 1 << " =",
+                       yystack_[(yynrhs) - (yyi + 1)]);
+  }
+#endif // YYDEBUG
+
+  parser::symbol_kind_type
+  parser::yytranslate_ (int t) YY_NOEXCEPT
+  {
+    // YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to
+    // TOKEN-NUM as returned by yylex.
+    static
+    const signed char
+    translate_table[] =
+    {
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+      29,    30,    25,    23,    34,    24,    28,    26,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,    33,    36,
+      22,    35,    21,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    31,     2,    32,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    27
+    };
+    // Last valid token kind.
+    const int code_max = 276;
+
+    if (t <= 0)
+      return symbol_kind::S_YYEOF;
+    else if (t <= code_max)
+      return static_cast <symbol_kind_type> (translate_table[t]);
+    else
+      return symbol_kind::S_YYUNDEF;
+  }
+
+} // yy
+#line 1467 "quack.tab.cxx"
+
+#line 359 "quack.yxx"
+
+
+void yy::parser::error(const location_type& loc, const std::string& msg)
+{
+  report::error_at(loc, msg);
+}
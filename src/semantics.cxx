@@ -18,8 +18,15 @@ struct MethodNode {
 	vector<string> formals;
 	vector<string> vars;
 	map<string,string> types;
+	AST::Method *ast = nullptr; // Definition, unless built in
+	// By variable: the type inference units that read its type
+	map<string,set<int>> readers;
 };
 
+// A class's place in all_types: its preorder number once topoSort has
+// run (built-in classes first, Obj 0 to Nothing 4, as in Builtins.c)
+typedef int TypeId;
+
 struct TypeNode {
 	TypeNode(){}
 	TypeNode(string n, string p){
@@ -27,6 +34,12 @@ struct TypeNode {
 	}
 	string name;
 	string parent;
+	TypeId id = -1;
+	TypeId parent_id = -1;         // -1 for Obj
+	vector<TypeId> children;
+	// Greatest id among the subclasses (or id): t is a subclass of u
+	// exactly when u.id <= t.id <= u.last_descendant
+	TypeId last_descendant = -1;
 	vector<string> instance_vars;
 	map<string,MethodNode> methods;
 	vector<string> methods_list;
@@ -37,10 +50,10 @@ class Semantics {
 public:
 	AST::Program *root;
 	vector<string> all_types; // topo-sorted vector of types
+	vector<TypeNode*> types;  // The same, indexed by TypeId
 	set<string> all_methods; // for use populating
 	set<string> fake_global; // for use with instantiation check
 	map<string,TypeNode> hierarchy;
-	int changed = 1;
 
 	Semantics(AST::Program *rootptr){ root = rootptr; }
 
@@ -120,6 +133,29 @@ public:
 		hierarchy["Obj"].methods_list.push_back("PRINT");
 		all_methods.insert("PRINT");
 
+		basic_method = MethodNode("EQUALS");
+		basic_method.returns = "Boolean";
+		basic_method.inherited_from = "Obj";
+		basic_method.formals = {"x"};
+		basic_method.vars = {"x"};
+		basic_method.types["x"] = "Obj";
+		hierarchy["Obj"].methods["EQUALS"] = basic_method;
+		hierarchy["Obj"].methods_list.push_back("EQUALS");
+
+		// Built-in classes that override Obj methods in Builtins.c
+		map<string,vector<string>> overrides = {
+			{"Int", {"STR", "PRINT"}}, {"String", {"STR", "PRINT"}},
+			{"Boolean", {"STR"}}, {"Nothing", {"STR"}}
+		};
+		for (auto &o: overrides){
+			for (string m: o.second){
+				basic_method = hierarchy["Obj"].methods[m];
+				basic_method.inherited_from = o.first;
+				hierarchy[o.first].methods[m] = basic_method;
+				hierarchy[o.first].methods_list.push_back(m);
+			}
+		}
+
 		basic_method = MethodNode("PLUS");
 		basic_method.returns = "String";
 		basic_method.inherited_from = "String";
@@ -129,6 +165,16 @@ public:
 		//basic_method.local_vars["x"] = "String";
 		hierarchy["String"].methods["PLUS"] = basic_method;
 		hierarchy["String"].methods_list.push_back("PLUS");
+		MethodNode str_equals = basic_method;
+		str_equals.name = "EQUALS";
+		str_equals.returns = "Boolean";
+		hierarchy["String"].methods["EQUALS"] = str_equals;
+		hierarchy["String"].methods_list.push_back("EQUALS");
+		MethodNode str_less = basic_method;
+		str_less.name = "LESS";
+		str_less.returns = "Boolean";
+		hierarchy["String"].methods["LESS"] = str_less;
+		hierarchy["String"].methods_list.push_back("LESS");
 		basic_method.returns = "Int";
 		basic_method.inherited_from = "Int";
 		basic_method.formals = {"x"};
@@ -161,9 +207,12 @@ public:
 		for (AST::Class *c: classes){
 			name = c->name_.text_;
 			super = c->super_.text_;
-			if ((find(all_types.begin(),all_types.end(),name)!=all_types.end())||name=="Obj"){
+			if (type_id(name)>=0){
 				cerr << "Error: cannot re-define class "<<name<<"!" << endl; exit(1);
 			}
+			if (super=="Int"||super=="String"||super=="Boolean"||super=="Nothing"){
+				cerr << "Error: class "<<name<<" cannot extend built-in class "<<super<<"!" << endl; exit(1);
+			}
 			type = TypeNode(name, super);
 
 			// Build constructor
@@ -171,6 +220,7 @@ public:
 			MethodNode cons = MethodNode(name);
 			cons.returns = name;
 			cons.inherited_from = name;
+			cons.ast = constructor;
 			AST::Formals *formals_node = &(constructor->formals_);
 			vector<AST::Formal*> formals = formals_node->elements_;
 			for (AST::Formal *f: formals){
@@ -190,6 +240,7 @@ public:
 				MethodNode mn = MethodNode(mname);
 				mn.returns = m->returns_.text_;
 				mn.inherited_from = name;
+				mn.ast = m;
 				AST::Formals *formals_node = &(m->formals_);
 				vector<AST::Formal*> formals = formals_node->elements_;
 				for (AST::Formal *f: formals){
@@ -203,12 +254,20 @@ public:
 			}
 			this->add_type(type);
 		}
+		// Every class then has a superclass, so Obj is the only root
+		for (AST::Class *c: classes){
+			if (type_id(c->super_.text_)<0){
+				cerr << "Error: class "<<c->name_.text_<<" extends undefined class "<<c->super_.text_<<"!" << endl; exit(1);
+			}
+		}
 
+		this->link_types();
 		if (this->is_cyclic()){ //// Check that there are no cycles
 			cerr << "Error: Class structure contains a cycle!" << endl;
 			exit(1);
 		}
 		this->topoSort();
+		this->number_classes();
 		this->propagate_methods();
 
 		return 1;
@@ -220,7 +279,13 @@ public:
 		// For each class and the main body:
 		// check variable instantiation.
 		vector<AST::Class*> classes = root->classes_.elements_;
-		vector<string> tmp;
+
+		// Class and method names are defined everywhere
+		Names everywhere;
+		for (string t: all_types){ everywhere.insert(t); }
+		for (string m: all_methods){ everywhere.insert(m); }
+		everywhere.insert("True");
+		everywhere.insert("False");
 
 		for (AST::Class *c: classes){
 			string name = c->name_.text_;
@@ -230,21 +295,18 @@ public:
 			vector<AST::Statement*> *sts = (vector<AST::Statement*> *) &(sts_node->elements_);
 			vector<string> *fs = &(hierarchy[name].methods[name].formals);
 
-			tmp = vector<string>();
-			for (string f: *fs){ unique_push_back(&tmp, f); } //
-			for (string t: all_types){ unique_push_back(&tmp, t); }
-			for (string m: all_methods){ unique_push_back(&tmp, m); }
-			unique_push_back(&tmp, "this");
-			unique_push_back(&tmp, "True");
-			unique_push_back(&tmp, "False");
+			Names tmp(&everywhere);
+			for (string f: *fs){ tmp.insert(f); }
+			tmp.insert("this");
 
 			for (AST::Statement *st: *sts){
 				int success = st->init_check(&tmp);
 				if (!success){return 0;}
 			}
-			for (string v: tmp){
-				if (v.find("this")!=string::npos){
-					unique_push_back(&hierarchy[name].instance_vars, v);
+			for (Symbol v: tmp.own()){
+				const string &vname = symbols().name(v);
+				if (vname.find("this")!=string::npos){
+					unique_push_back(&hierarchy[name].instance_vars, vname);
 				}
 			}	
 
@@ -253,18 +315,14 @@ public:
 			vector<AST::Method*> methods =  method_node->elements_;
 			for (AST::Method *m: methods){
 				string mname = m->name_.text_;
-				tmp = vector<string>();
+				Names tmp(&everywhere);
 				for (string v: hierarchy[name].instance_vars){
-					unique_push_back(&tmp, v);
+					tmp.insert(v);
 					unique_push_back(&hierarchy[name].methods[mname].vars, v);
 				}
 				vector<string> *mformals = &(hierarchy[name].methods[mname].formals);
-				for (string f: *mformals){ unique_push_back(&tmp, f); }
-				for (string t: all_types){ unique_push_back(&tmp, t); }
-				for (string m: all_methods){ unique_push_back(&tmp, m); }
-				unique_push_back(&tmp, "this");
-				unique_push_back(&tmp, "True");
-				unique_push_back(&tmp, "False");
+				for (string f: *mformals){ tmp.insert(f); }
+				tmp.insert("this");
 				sts_node =  &(m->statements_);
 				sts = (vector<AST::Statement*> *) &(sts_node->elements_);
 				for (AST::Statement *st: *sts){
@@ -277,11 +335,7 @@ public:
 		// then also check instantiation of body
 		AST::Block *body = &(root->statements_);
 		vector<AST::Statement*> *body_sts = (vector<AST::Statement*> *) &(body->elements_);
-		vector<string> body_vars;
-		for (string t: all_types){ unique_push_back(&body_vars, t); }
-		for (string m: all_methods){ unique_push_back(&body_vars, m); }
-		unique_push_back(&body_vars, "True");
-		unique_push_back(&body_vars, "False");
+		Names body_vars(&everywhere);
 
 		for (AST::Statement *st: *body_sts){
 			int success = st->init_check(&body_vars);
@@ -295,19 +349,145 @@ public:
 	//================================================//
 	int check_types(){
 		// Do type inference
-		Whereami whereami = Whereami("Main", "Main");
 		TypeNode main = TypeNode("Main", "Obj");// parent???
         hierarchy["Main"] = TypeNode("Main", "Main");
         hierarchy["Main"].methods_list.push_back("Main");
         hierarchy["Main"].methods["Main"] = MethodNode("Main");
 
-		while (changed){
-			changed = 0;
-			root->infer_type(this, whereami);
+		// Each class's constructor, each method, and the main program is
+		// inferred once in program order, then again only when a type it
+		// read has changed
+		for (AST::Class *c: root->classes_.elements_){
+			string name = c->name_.text_;
+			units.push_back(InferUnit(Whereami(name, name), c));
+			for (AST::Method *m: c->methods_.elements_){
+				units.push_back(InferUnit(Whereami(name, m->name_.text_), m));
+			}
+		}
+		units.push_back(InferUnit(Whereami("Main", "Main"), root));
+		for (int u=0; u<units.size(); u++){ rank.push_back(u); }
+		for (int u=0; u<units.size(); u++){ infer_unit(u); }
+
+		rank_units();
+		set<pair<int,int>> again;
+		for (pair<int,int> r: stale){ again.insert(make_pair(rank[r.second], r.second)); }
+		stale = again;
+		while (!stale.empty()){
+			int u = stale.begin()->second;
+			stale.erase(stale.begin());
+			infer_unit(u);
+		}
+
+		if (report!=nullptr){
+			for (InferUnit &unit: units){
+				string name = unit.where.classname;
+				if (unit.where.methodname!=name){ name += "."+unit.where.methodname; }
+				*report<<name<<": inferred "<<unit.runs<<(unit.runs==1 ? " time" : " times")<<endl;
+			}
 		}
 		return 1;
 	}
 
+	//================================================//
+	//================================================//
+	// TYPE INFERENCE WORKLIST //
+	//================================================//
+	//================================================//
+
+	// A unit notes the variable types it reads (its own variables, the
+	// fields of classes, and the formals of what it calls) so that a
+	// change to one reschedules just the units that read it.
+	typedef pair<MethodNode*,string> Var;
+	struct InferUnit {
+		InferUnit(Whereami w, AST::ASTNode *n){ where = w; node = n; }
+		Whereami where;
+		AST::ASTNode *node;  // Class (its constructor), Method, or Program (the main statements)
+		vector<Var> reads;   // Variables whose types the last run read
+		set<Var> writes;     // Variables whose types it has changed
+		int runs = 0;
+	};
+	vector<InferUnit> units;
+	int running = -1;               // The unit being inferred
+	set<pair<int,int>> stale;       // Units to infer again, by rank
+	vector<int> rank;               // Units that others read from come first
+	ostream *report = nullptr;      // --report-types: how often each unit was inferred
+
+	void type_read(MethodNode *method, const string &vname){
+		if (running<0){ return; }
+		if (method->readers[vname].insert(running).second){
+			units[running].reads.push_back(make_pair(method, vname));
+		}
+	}
+
+	void type_changed(MethodNode *method, const string &vname){
+		if (running>=0){ units[running].writes.insert(make_pair(method, vname)); }
+		map<string,set<int>>::iterator found = method->readers.find(vname);
+		if (found==method->readers.end()){ return; }
+		for (int u: found->second){ stale.insert(make_pair(rank[u], u)); }
+	}
+
+	void infer_unit(int u){
+		InferUnit &unit = units[u];
+		for (Var &v: unit.reads){ v.first->readers[v.second].erase(u); }
+		unit.reads.clear();
+		unit.runs++;
+		running = u;
+		unit.node->infer_type(this, unit.where);
+		running = -1;
+	}
+
+	// Rank the units by the strongly connected components of "reads a
+	// type written by", so that a change settles in the units it comes
+	// from before those reading them are inferred again
+	void rank_units(){
+		vector<vector<int>> users(units.size());
+		for (int u=0; u<units.size(); u++){
+			for (const Var &w: units[u].writes){
+				map<string,set<int>>::iterator found = w.first->readers.find(w.second);
+				if (found==w.first->readers.end()){ continue; }
+				for (int v: found->second){ if (v!=u){ users[u].push_back(v); } }
+			}
+		}
+		vector<int> index(units.size(), -1), low(units.size()), path;
+		vector<bool> on_path(units.size(), false);
+		vector<vector<int>> components; // users before the units they read from
+		int next = 0;
+		for (int u=0; u<units.size(); u++){
+			if (index[u]<0){ strong_connect(u, users, index, low, path, on_path, components, next); }
+		}
+		int r = 0;
+		for (int c=components.size()-1; c>=0; c--){
+			for (int u: components[c]){ rank[u] = r; }
+			r++;
+		}
+	}
+
+	// Tarjan's algorithm
+	void strong_connect(int u, vector<vector<int>> &users, vector<int> &index, vector<int> &low,
+			vector<int> &path, vector<bool> &on_path, vector<vector<int>> &components, int &next){
+		index[u] = low[u] = next++;
+		path.push_back(u);
+		on_path[u] = true;
+		for (int v: users[u]){
+			if (index[v]<0){
+				strong_connect(v, users, index, low, path, on_path, components, next);
+				low[u] = min(low[u], low[v]);
+			}
+			else if (on_path[v]){ low[u] = min(low[u], index[v]); }
+		}
+		if (low[u]==index[u]){
+			vector<int> component;
+			int v;
+			do {
+				v = path.back();
+				path.pop_back();
+				on_path[v] = false;
+				component.push_back(v);
+			} while (v!=u);
+			components.push_back(component);
+		}
+	}
+
 	//================================================//
 	//================================================//
 	// HELPER FUNCTIONS //
@@ -317,10 +497,18 @@ public:
 	void unique_update(string vname, string type, Whereami whereami){
 		// NOTE: This method should only be used
 			// after finding least common ancestor type!!!
-		MethodNode *local = &((hierarchy)[whereami.classname].methods[whereami.methodname]);
+		unique_update(&((hierarchy)[whereami.classname].methods[whereami.methodname]), vname, type);
+	}
+
+	void unique_update(MethodNode *local, const string &vname, const string &type){
 		int found = 0;
 
-		for (string v: local->vars){
+		// Already this type (a variable other than "this" given a type
+		// is always among the vars): nothing to do
+		map<string,string>::iterator known = local->types.find(vname);
+		if (known!=local->types.end() && known->second==type && !type.empty() && vname!="this"){ return; }
+
+		for (const string &v: local->vars){
 			if (v==vname){
 				found = 1;
 				if (local->types[v]!=type){
@@ -330,7 +518,7 @@ public:
 					// 	exit(1);
 					// }
 					local->types[v] = type;
-					changed=1; 
+					type_changed(local, v);
 				}
 				break;
 			}
@@ -338,30 +526,27 @@ public:
 		if (!found){
 			local->vars.push_back(vname);
 			local->types[vname] = type;
-			changed = 1;
+			type_changed(local, vname);
 		}
 	}
 
 	string get_curr_type(string vname, Whereami whereami){
 		MethodNode *local = &((hierarchy)[whereami.classname].methods[whereami.methodname]);
-		map<string,string>::iterator it;
 
 		if (vname=="this"){return whereami.classname;}
 
 		if (vname=="true"||vname=="false"){return "Boolean";}
 
-        for (it=local->types.begin(); it!=local->types.end(); it++) {
-            if (it->first==vname){
-            	return it->second;
-            }
-        }
-        
-        map<string,string> *class_vars = &(hierarchy[whereami.classname].methods[whereami.classname].types);
-        for (it=class_vars->begin(); it!=class_vars->end(); it++) {
-            if (it->first=="this."+vname && (it->first).find("this")!=string::npos){ //load the this.vname if possible
-            	return it->second;
-            }
-        }
+		type_read(local, vname);
+		map<string,string>::iterator it = local->types.find(vname);
+		if (it!=local->types.end()){ return it->second; }
+
+		//load the this.vname if possible
+		MethodNode *constructor = &(hierarchy[whereami.classname].methods[whereami.classname]);
+		map<string,string> *class_vars = &(constructor->types);
+		type_read(constructor, "this."+vname);
+		it = class_vars->find("this."+vname);
+		if (it!=class_vars->end()){ return it->second; }
 		return "BOTTOM";
 	}
 
@@ -371,47 +556,60 @@ public:
 		if (t2=="BOTTOM"){ return t1; }
 		if (t1=="TOP"||t2=="TOP"){ return "TOP"; }
 
-		vector<string> t1_ancestors = vector<string>();
-		vector<string> t2_ancestors = vector<string>();
-
-		string parent = hierarchy[t1].name;
-		while (parent!="TOP"){
-			t1_ancestors.push_back(parent);
-			parent = hierarchy[parent].parent;
+		TypeId u = type_id(t1), v = type_id(t2);
+		if (u<0 || v<0){ return "TOP"; }
+		if (is_descendant(v, u)){ return t1; }
+		// Climb from u to the highest ancestor that is not above v; its
+		// parent is the common ancestor
+		for (int k=ancestor.size()-1; k>=0; k--){
+			if (!is_descendant(v, ancestor[k][u])){ u = ancestor[k][u]; }
 		}
+		return all_types[types[u]->parent_id];
+	}
 
-		parent = hierarchy[t2].name;
-		while (parent!="TOP"){
-			t2_ancestors.push_back(parent);
-			parent = hierarchy[parent].parent;
-		}
-
-		int min_parents;
-		if (t1_ancestors.size()<t2_ancestors.size()){
-			min_parents = t1_ancestors.size(); }
-		else { min_parents = t2_ancestors.size(); }
-
-		string newtype = "TOP";
-		string t1a, t2a;
-		for (int i=0; i<min_parents; i++){
-			t1a = t1_ancestors[t1_ancestors.size()-i-1];
-			t2a = t2_ancestors[t2_ancestors.size()-i-1];
-			if (t1a==t2a){ newtype = t1a; }
-			else { break; }
-		}
-		return newtype;
+	// The class called name, or -1 if there is none
+	TypeId type_id(const string &name){
+		Symbol sym = symbols().lookup(name);
+		return (sym>=0 && sym<type_of.size()) ? type_of[sym] : -1;
 	}
 
 	int is_subtype(string subtype, string supertype){
 		if (subtype=="BOTTOM"){return 1;}
 		if (supertype=="TOP"){ return 1; }
 		
-		string parent = hierarchy[subtype].name;
-		while (parent!="TOP"){
-			if (parent==supertype){ return 1; }
-			parent = hierarchy[parent].parent;
+		TypeId sub = type_id(subtype), super = type_id(supertype);
+		return sub>=0 && super>=0 && is_descendant(sub, super);
+	}
+
+	// t is u or one of its subclasses
+	bool is_descendant(TypeId t, TypeId u){
+		return types[u]->id<=t && t<=types[u]->last_descendant;
+	}
+
+	// Class hierarchy analysis: the classes whose implementations of
+	// method an instance of type (or of any subclass) might run, with
+	// type's own first and then the overrides in preorder.
+	vector<string> impls(string type, string method){
+		vector<string> found;
+		if (hierarchy.count(type)==0 || hierarchy[type].methods.count(method)==0){
+			return found;
 		}
-		return 0;
+		vector<string> work = {type};
+		while (!work.empty()){
+			string t = work.back();
+			work.pop_back();
+			unique_push_back(&found, hierarchy[t].methods[method].inherited_from);
+			vector<string> children = get_children(t);
+			work.insert(work.end(), children.rbegin(), children.rend());
+		}
+		return found;
+	}
+
+	// The implementation every such call runs, or "" if subclasses
+	// override it and the call must be dispatched.
+	string unique_impl(string type, string method){
+		vector<string> found = impls(type, method);
+		return found.size()==1 ? found[0] : "";
 	}
 
 	int check_formals(vector<string> expected, vector<string> provided, Whereami whereami){
@@ -468,6 +666,8 @@ public:
 
     void emit_class_struct(CodegenContext &ctxt, string cname){
     	vector<string> methods = this->hierarchy[cname].methods_list;
+    	TypeNode &type = hierarchy[cname];
+    	ctxt.emit(to_string(type.id)+", "+to_string(type.last_descendant)+", // Class ids");
     	for (string m: methods){
     		MethodNode method = this->hierarchy[cname].methods[m];
     		if (m==cname){ctxt.emit("new_"+cname+", // Constructor");}
@@ -475,49 +675,56 @@ public:
     			ctxt.emit(method.inherited_from+"_method_"+m+",");
     		}
     	}
-    	cout<<endl;
+    	ctxt.emit("");
     }
 
 	//================================================//
 	//================================================//
 	void propagate_instance_var_types(string clazz){
 		// pass down "this" vars to all local method scopes
-		vector<string> ivs = hierarchy[clazz].instance_vars;
-		Whereami here;
-		here.classname = clazz;
-		for (string m: hierarchy[clazz].methods_list){
+		TypeNode *type = &hierarchy[clazz];
+		MethodNode *constructor = &(type->methods[clazz]);
+		for (string iv: type->instance_vars){ type_read(constructor, iv); }
+		for (string m: type->methods_list){
 			if (m==clazz){continue;}//don't need to share with myself
-			here.methodname = m;
-			for (string iv: ivs){
-				unique_update(iv, hierarchy[clazz].methods[clazz].types[iv], here);
+			MethodNode *local = &(type->methods[m]);
+			for (string iv: type->instance_vars){
+				unique_update(local, iv, constructor->types[iv]);
 			}
 		}
 	}
 
 	void propagate_methods(){
-		for (string clazz: all_types){
-			TypeNode type = hierarchy[clazz];
-			vector<string> children = get_children(clazz);
-			map<string,MethodNode>::iterator it;
-			for (string m: hierarchy[clazz].methods_list){
-				if (m==clazz){ continue; } //dont propagate constructor
-				for (string c: children){
-					int found = 0;
-					for (string childmethod: hierarchy[c].methods_list){
-						if (childmethod==m){ 
-							// dont need to add, but do need to typecheck!
-							// TYPECHECK THIS: TODO
-							found = 1; break;
-						}
+		// Each child's method table starts with its constructor, then
+		// the parent's methods in the parent's order (inherited or
+		// overridden), then the methods the child introduces, so that
+		// a child's class struct can be used through its parent's type.
+		for (TypeNode *parent: types){
+			for (TypeId child_id: parent->children){
+				TypeNode &child = *types[child_id];
+				vector<string> &own = child.methods_list;
+				set<Symbol> defined; // by the child
+				for (string m: own){ defined.insert(symbols().intern(m)); }
+				vector<string> ordered;
+				set<Symbol> placed;
+				ordered.push_back(child.name);
+				placed.insert(symbols().intern(child.name));
+				for (string m: parent->methods_list){
+					if (m==parent->name){ continue; } //dont propagate constructor
+					Symbol sym = symbols().intern(m);
+					if (defined.count(sym)==0){ 
+						child.methods[m] = parent->methods[m];
 					}
-					if (!found){ 
-						MethodNode mn = MethodNode(hierarchy[clazz].methods[m]);
-						//mn.inherited_from = clazz;
-						mn.inherited_from = hierarchy[clazz].methods[m].inherited_from;
-						hierarchy[c].methods[mn.name] = mn;
-						hierarchy[c].methods_list.push_back(mn.name);
+					// else overridden: TYPECHECK THIS: TODO
+					ordered.push_back(m);
+					placed.insert(sym);
+				}
+				for (string m: own){
+					if (placed.insert(symbols().intern(m)).second){
+						ordered.push_back(m);
 					}
-				}				
+				}
+				child.methods_list = ordered;
 			}
 		}
 	}
@@ -526,80 +733,88 @@ public:
 	//================================================//
 	private:
 
-	int rec_check_cyclic(int ind, vector<int> visited, vector<int> to_recurse){
-
-		visited[ind] = 1;
-		to_recurse[ind] = 1;
-
-		int j;
-		if (hierarchy[all_types[ind]].parent=="TOP"){return 0;}
-		for (int k=0; k<all_types.size(); k++){
-			if (all_types[k]==hierarchy[all_types[ind]].parent){ j = k; break; }
-		}
-
-		if  (!visited[j] && rec_check_cyclic(j, visited, to_recurse)){
-			return 1;
-		} else if (to_recurse[j]){
-			return 1;
-		}
-		return 0;
-	}
-
 	int is_cyclic(){
-		vector<int> visited;
-		vector<int> to_recurse;
-
-		for (int i=0; i<all_types.size(); i++){
-			visited.push_back(0);
-			to_recurse.push_back(0);
-		}
-		for (int i=0; i<all_types.size(); i++){
-			if (visited[i]){ continue; }
-			if ( rec_check_cyclic(i, visited, to_recurse) ){
-				return 1; // found a cycle
+		// Follow each class's chain of superclasses, marking the classes
+		// on the chain being followed (1) and those that reach the top (2)
+		vector<int> state(all_types.size(), 0);
+		for (TypeId t=0; t<all_types.size(); t++){
+			vector<TypeId> chain;
+			TypeId c = t;
+			while (c>=0 && state[c]==0){
+				state[c] = 1;
+				chain.push_back(c);
+				c = types[c]->parent_id;
 			}
+			if (c>=0 && state[c]==1){ return 1; }
+			for (TypeId k: chain){ state[k] = 2; }
 		}
 		return 0;
 	}
 
-	void topoSortUtil(int ind, vector<int> &visited, vector<int> &order) { 
-		visited[ind] = 1;
-		order.push_back(ind);
-		// recurse for each child
-		string curr_type = all_types[ind];
-		vector<int> children;
-		for (int i=0; i<all_types.size(); i++){
-			if (hierarchy[all_types[i]].parent==curr_type){
-				children.push_back(i);
-			}
-		}
-		for (int i: children){
-			if (!visited[i]){ topoSortUtil(i, visited, order); }
-			else { break; } // found a cycle! shouldn't happen!
+	void topoSortUtil(TypeId t, vector<int> &visited, vector<TypeId> &order) { 
+		visited[t] = 1;
+		order.push_back(t);
+		for (TypeId c: types[t]->children){
+			if (!visited[c]){ topoSortUtil(c, visited, order); }
 		}
 	} 
 	void topoSort() { 
-		vector<int> visited; //ordered by all_types
-		vector<int> order; // toposorted classes ordered as above
+		vector<int> visited(all_types.size(), 0);
+		vector<TypeId> order; // preorder of the classes, by their old ids
 
-		for (int i=0; i<all_types.size(); i++){ visited.push_back(0); }
-		for (int i=0; i<all_types.size(); i++){
-			if (!visited[i]){ topoSortUtil(i, visited, order); }	
+		for (TypeId t=0; t<all_types.size(); t++){
+			if (!visited[t]){ topoSortUtil(t, visited, order); }	
 		}
 		if (order.size()!=all_types.size()){
 			cerr<<"Issue with toposort! Wrong number of classes output."<<endl;
 			exit(1);
 		}
-		for (int i=0; i<order.size(); i++){
-			this->all_types[i] = all_types[order[i]];
+		vector<string> sorted;
+		vector<TypeNode*> sorted_types;
+		for (TypeId t: order){
+			sorted.push_back(all_types[t]);
+			sorted_types.push_back(types[t]);
+		}
+		this->all_types = sorted;
+		this->types = sorted_types;
+		for (TypeId t=0; t<all_types.size(); t++){
+			types[t]->id = t;
+			type_of[symbols().lookup(all_types[t])] = t;
 		}
+		link_types();
 	} 
 
+	void number_classes(){
+		// all_types is in preorder, so each class's subclasses follow it
+		for (TypeId t=0; t<all_types.size(); t++){ types[t]->last_descendant = t; }
+		for (TypeId t=all_types.size()-1; t>0; t--){
+			TypeId p = types[t]->parent_id;
+			if (p>=0){ types[p]->last_descendant = max(types[p]->last_descendant, types[t]->last_descendant); }
+		}
+		// Ancestor tables for type_union: ancestor[k][t] is t's 2^k-th
+		// superclass, or Obj if it has fewer
+		ancestor.clear();
+		ancestor.push_back(vector<TypeId>(all_types.size(), 0));
+		int height = 0;
+		vector<int> depth(all_types.size(), 0);
+		for (TypeId t=1; t<all_types.size(); t++){
+			ancestor[0][t] = types[t]->parent_id;
+			depth[t] = depth[types[t]->parent_id]+1;
+			height = max(height, depth[t]);
+		}
+		for (int k=1; (1<<k)<=height; k++){
+			ancestor.push_back(vector<TypeId>(all_types.size()));
+			for (TypeId t=0; t<all_types.size(); t++){
+				ancestor[k][t] = ancestor[k-1][ancestor[k-1][t]];
+			}
+		}
+	}
+
 	vector<string> get_children(string type){
 		vector<string> children;
-		for (string t: all_types){
-			if (hierarchy[t].parent==type){ children.push_back(t); }
-		}
+		TypeId t = type_id(type);
+		if (t<0){ return children; }
+		for (TypeId c: types[t]->children){ children.push_back(all_types[c]); }
 		return children;
 	}
 
@@ -609,10 +824,27 @@ public:
 	}
 
 	void add_type(TypeNode type){
+		type.id = all_types.size();
+		Symbol sym = symbols().intern(type.name);
+		if (sym>=type_of.size()){ type_of.resize(sym+1, -1); }
+		type_of[sym] = type.id;
 		this->hierarchy[type.name] = type;
 		this->all_types.push_back(type.name);
+		this->types.push_back(&hierarchy[type.name]);
 	}
 
+	// Each class's superclass and subclasses, by id
+	void link_types(){
+		for (TypeNode *t: types){ t->children.clear(); }
+		for (TypeNode *t: types){
+			t->parent_id = type_id(t->parent);
+			if (t->parent_id>=0){ types[t->parent_id]->children.push_back(t->id); }
+		}
+	}
+
+	vector<TypeId> type_of; // By Symbol: the class of that name, or -1
+	vector<vector<TypeId>> ancestor; // By power of two, then TypeId
+
 
 };
 